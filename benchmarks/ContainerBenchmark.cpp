@@ -1,6 +1,13 @@
 #include <benchmark/benchmark.h>
 
+#include <unistd.h>
+
+#include <cstring>
+#include <vector>
+
 #include "../include/knot-di/Container.hpp"
+#include "../include/knot-di/Scope.hpp"
+#include "../include/knot-di/StaticContainer.hpp"
 
 static void BM_Container_RegisterManySingletons(benchmark::State& state) {
   struct Dummy {
@@ -119,3 +126,672 @@ static void BM_Container_ResolveComplex(benchmark::State& state) {
   }
 }
 BENCHMARK(BM_Container_ResolveComplex);
+
+template <int N>
+struct LatencyService {
+  int x;
+  LatencyService() : x(N) {}
+};
+
+template <int N>
+struct RegisterLatencyServices {
+  static void run(Knot::Container& c) {
+    c.registerService<LatencyService<N> >(SINGLETON);
+    RegisterLatencyServices<N - 1>::run(c);
+  }
+};
+
+template <>
+struct RegisterLatencyServices<0> {
+  static void run(Knot::Container&) {}
+};
+
+// LatencyService<1> регистрируется последним, т.е. это худший случай для
+// линейного поиска по реестру.
+template <int N>
+static void BM_Container_ResolveLatency(benchmark::State& state) {
+  Knot::Container c(1 << 16);
+  RegisterLatencyServices<N>::run(c);
+  for (auto _ : state) {
+    LatencyService<1>* s = c.resolve<LatencyService<1> >();
+    benchmark::DoNotOptimize(s);
+  }
+}
+BENCHMARK_TEMPLATE(BM_Container_ResolveLatency, 4);
+BENCHMARK_TEMPLATE(BM_Container_ResolveLatency, 16);
+BENCHMARK_TEMPLATE(BM_Container_ResolveLatency, 64);
+BENCHMARK_TEMPLATE(BM_Container_ResolveLatency, 256);
+
+// Пулы соединений по шардам, зарегистрированные под целыми ключами.
+struct ShardConnection {
+  int shard;
+  explicit ShardConnection(int s) : shard(s) {}
+};
+
+static void RegisterShards(Knot::Container& c, int count) {
+  for (int i = 0; i < count; ++i)
+    c.registerService<ShardConnection>(i, SINGLETON, i);
+}
+
+static void BM_Container_ResolveKeyed(benchmark::State& state) {
+  Knot::Container c(1 << 16);
+  RegisterShards(c, 64);
+  int shard = 0;
+  for (auto _ : state) {
+    ShardConnection* s = c.resolve<ShardConnection>(shard);
+    benchmark::DoNotOptimize(s);
+    shard = (shard + 1) & 63;
+  }
+}
+BENCHMARK(BM_Container_ResolveKeyed);
+
+// То же после seal(): поиск в совершенной хеш-таблице без пробирования.
+static void BM_Container_ResolveKeyedSealed(benchmark::State& state) {
+  Knot::Container c(1 << 16);
+  RegisterShards(c, 64);
+  c.seal();
+  int shard = 0;
+  for (auto _ : state) {
+    ShardConnection* s = c.resolve<ShardConnection>(shard);
+    benchmark::DoNotOptimize(s);
+    shard = (shard + 1) & 63;
+  }
+}
+BENCHMARK(BM_Container_ResolveKeyedSealed);
+
+// Строка хешируется при каждом вызове.
+static void BM_Container_ResolveKeyedString(benchmark::State& state) {
+  Knot::Container c(1 << 16);
+  c.registerService<ShardConnection>("shard-primary", SINGLETON, 0);
+  for (auto _ : state) {
+    ShardConnection* s = c.resolve<ShardConnection>("shard-primary");
+    benchmark::DoNotOptimize(s);
+  }
+}
+BENCHMARK(BM_Container_ResolveKeyedString);
+
+static void BM_Container_ResolveKeyedHandle(benchmark::State& state) {
+  Knot::Container c(1 << 16);
+  RegisterShards(c, 64);
+  Knot::ServiceHandle<ShardConnection> handles[64];
+  for (int i = 0; i < 64; ++i) handles[i] = c.handle<ShardConnection>(i);
+  int shard = 0;
+  for (auto _ : state) {
+    ShardConnection* s = c.resolve(handles[shard]);
+    benchmark::DoNotOptimize(s);
+    shard = (shard + 1) & 63;
+  }
+}
+BENCHMARK(BM_Container_ResolveKeyedHandle);
+
+// Реализация со вторым базовым классом: указатель на IMetricsSink смещен
+// относительно начала объекта.
+struct IMetricsSource {
+  virtual int source() const = 0;
+};
+
+struct IMetricsSink {
+  virtual int sink() const = 0;
+};
+
+struct MetricsChannel : IMetricsSource, IMetricsSink {
+  int x;
+  MetricsChannel() : x(1) {}
+  int source() const { return x; }
+  int sink() const { return x; }
+};
+
+// Для сравнения с BM_Container_ResolveSingleton: разрешение по интерфейсу
+// остается загрузкой уже смещенного указателя.
+static void BM_Container_ResolveBoundSingleton(benchmark::State& state) {
+  Knot::Container c;
+  c.registerService<IMetricsSink, MetricsChannel>(SINGLETON);
+  for (auto _ : state) {
+    IMetricsSink* s = c.resolve<IMetricsSink>();
+    benchmark::DoNotOptimize(s);
+  }
+}
+BENCHMARK(BM_Container_ResolveBoundSingleton);
+
+static void BM_Container_ResolveBoundTransient(benchmark::State& state) {
+  Knot::Container c;
+  c.registerService<IMetricsSink, MetricsChannel>(TRANSIENT);
+  for (auto _ : state) {
+    IMetricsSink* s = c.resolve<IMetricsSink>();
+    benchmark::DoNotOptimize(s);
+    c.destroyTransient(s);
+  }
+}
+BENCHMARK(BM_Container_ResolveBoundTransient);
+
+// Цепочка синглтонов: WiredService<N> зависит от WiredService<N - 1>.
+template <int N>
+struct WiredService {
+  WiredService<N - 1>* prev;
+  char payload[256];
+  explicit WiredService(WiredService<N - 1>* p) : prev(p) {
+    std::memset(payload, N, sizeof(payload));
+    benchmark::ClobberMemory();
+  }
+};
+
+template <>
+struct WiredService<0> {
+  char payload[256];
+  WiredService() {
+    std::memset(payload, 0, sizeof(payload));
+    benchmark::ClobberMemory();
+  }
+};
+
+template <int N>
+struct RegisterWired {
+  // Зависимость разрешается при регистрации, т.е. создается сразу.
+  static void eager(Knot::Container& c) {
+    RegisterWired<N - 1>::eager(c);
+    c.registerService<WiredService<N> >(SINGLETON,
+                                        c.resolve<WiredService<N - 1> >());
+  }
+  static void lazy(Knot::Container& c) {
+    RegisterWired<N - 1>::lazy(c);
+    c.registerService<WiredService<N> >(SINGLETON,
+                                        c.inject<WiredService<N - 1> >());
+  }
+};
+
+template <>
+struct RegisterWired<0> {
+  static void eager(Knot::Container& c) {
+    c.registerService<WiredService<0> >(SINGLETON);
+  }
+  static void lazy(Knot::Container& c) {
+    c.registerService<WiredService<0> >(SINGLETON);
+  }
+};
+
+// Зарегистрировано 64 сервиса, но приложению нужен только WiredService<8>.
+static void BM_Container_StartupEagerWiring(benchmark::State& state) {
+  for (auto _ : state) {
+    Knot::Container c(1 << 16);
+    RegisterWired<63>::eager(c);
+    benchmark::DoNotOptimize(c.resolve<WiredService<8> >());
+  }
+}
+BENCHMARK(BM_Container_StartupEagerWiring);
+
+static void BM_Container_StartupLazyWiring(benchmark::State& state) {
+  for (auto _ : state) {
+    Knot::Container c(1 << 16);
+    RegisterWired<63>::lazy(c);
+    benchmark::DoNotOptimize(c.resolve<WiredService<8> >());
+  }
+}
+BENCHMARK(BM_Container_StartupLazyWiring);
+
+// Дорогой синглтон, нужный только на редком пути обработчика.
+struct ColdIndex {
+  char table[1 << 16];
+  ColdIndex() {
+    std::memset(table, 1, sizeof(table));
+    benchmark::ClobberMemory();
+  }
+};
+
+struct EagerHandler {
+  ColdIndex* index;
+  explicit EagerHandler(ColdIndex* i) : index(i) {}
+};
+
+struct DeferredHandler {
+  Knot::Lazy<ColdIndex> index;
+  explicit DeferredHandler(Knot::Lazy<ColdIndex> i) : index(i) {}
+};
+
+// Запуск процесса, который не доходит до редкого пути: inject создает
+// ColdIndex вместе с обработчиком, lazy откладывает его до обращения.
+static void BM_Container_StartupInjectedColdPath(benchmark::State& state) {
+  for (auto _ : state) {
+    Knot::Container c(1 << 18);
+    c.registerService<ColdIndex>(SINGLETON);
+    c.registerService<EagerHandler>(SINGLETON, c.inject<ColdIndex>());
+    benchmark::DoNotOptimize(c.resolve<EagerHandler>());
+  }
+}
+BENCHMARK(BM_Container_StartupInjectedColdPath);
+
+static void BM_Container_StartupLazyColdPath(benchmark::State& state) {
+  for (auto _ : state) {
+    Knot::Container c(1 << 18);
+    c.registerService<ColdIndex>(SINGLETON);
+    c.registerService<DeferredHandler>(SINGLETON, c.lazy<ColdIndex>());
+    benchmark::DoNotOptimize(c.resolve<DeferredHandler>());
+  }
+}
+BENCHMARK(BM_Container_StartupLazyColdPath);
+
+// Обращение через уже разрешенный Lazy: одна проверка перед указателем.
+static void BM_Container_LazyAccess(benchmark::State& state) {
+  Knot::Container c(1 << 18);
+  c.registerService<ColdIndex>(SINGLETON);
+  c.registerService<DeferredHandler>(SINGLETON, c.lazy<ColdIndex>());
+  DeferredHandler* handler = c.resolve<DeferredHandler>();
+  for (auto _ : state) {
+    ColdIndex* index = handler->index.get();
+    benchmark::DoNotOptimize(index);
+  }
+}
+BENCHMARK(BM_Container_LazyAccess);
+
+struct StaticBenchSingleton {
+  int x;
+  StaticBenchSingleton() : x(1) {}
+};
+
+struct StaticBenchTransient {
+  int x;
+  StaticBenchTransient(int v) : x(v) {}
+};
+
+typedef Knot::StaticContainer<Knot::TypeList<
+    Knot::Service<StaticBenchSingleton>,
+    Knot::Service<StaticBenchTransient, TRANSIENT,
+                  Knot::Factory1<StaticBenchTransient, int> > > >
+    StaticBenchContainer;
+
+static void BM_StaticContainer_ResolveSingleton(benchmark::State& state) {
+  StaticBenchContainer c;
+  for (auto _ : state) {
+    StaticBenchSingleton* s = c.resolve<StaticBenchSingleton>();
+    benchmark::DoNotOptimize(s);
+  }
+}
+BENCHMARK(BM_StaticContainer_ResolveSingleton);
+
+static void BM_Container_ResolveSingleton(benchmark::State& state) {
+  Knot::Container c;
+  c.registerService<StaticBenchSingleton>(SINGLETON);
+  for (auto _ : state) {
+    StaticBenchSingleton* s = c.resolve<StaticBenchSingleton>();
+    benchmark::DoNotOptimize(s);
+  }
+}
+BENCHMARK(BM_Container_ResolveSingleton);
+
+static void BM_StaticContainer_ResolveTransient(benchmark::State& state) {
+  StaticBenchContainer c;
+  c.configure<StaticBenchTransient>(42);
+  for (auto _ : state) {
+    StaticBenchTransient* t = c.resolve<StaticBenchTransient>();
+    benchmark::DoNotOptimize(t);
+    c.destroyTransient(t);
+  }
+}
+BENCHMARK(BM_StaticContainer_ResolveTransient);
+
+static void BM_Container_ResolveTransient(benchmark::State& state) {
+  Knot::Container c;
+  c.registerService<StaticBenchTransient>(TRANSIENT, 42);
+  for (auto _ : state) {
+    StaticBenchTransient* t = c.resolve<StaticBenchTransient>();
+    benchmark::DoNotOptimize(t);
+    c.destroyTransient(t);
+  }
+}
+BENCHMARK(BM_Container_ResolveTransient);
+
+// Для сравнения с BM_Container_ResolveSingleton и
+// BM_Container_ResolveTransient: запись реестра найдена один раз.
+static void BM_Container_ResolveSingletonRef(benchmark::State& state) {
+  Knot::Container c;
+  c.registerService<StaticBenchSingleton>(SINGLETON);
+  Knot::ServiceRef<StaticBenchSingleton> ref = c.ref<StaticBenchSingleton>();
+  for (auto _ : state) {
+    StaticBenchSingleton* s = ref.get();
+    benchmark::DoNotOptimize(s);
+  }
+}
+BENCHMARK(BM_Container_ResolveSingletonRef);
+
+static void BM_Container_ResolveTransientRef(benchmark::State& state) {
+  Knot::Container c;
+  c.registerService<StaticBenchTransient>(TRANSIENT, 42);
+  Knot::ServiceRef<StaticBenchTransient> ref = c.ref<StaticBenchTransient>();
+  for (auto _ : state) {
+    StaticBenchTransient* t = ref.get();
+    benchmark::DoNotOptimize(t);
+    c.destroyTransient(t);
+  }
+}
+BENCHMARK(BM_Container_ResolveTransientRef);
+
+// Контейнер на запрос: полная пересборка с N регистрациями против
+// дочернего контейнера, который находит их у родителя.
+template <int N>
+static void BM_Container_RequestRebuild(benchmark::State& state) {
+  for (auto _ : state) {
+    Knot::Container c;
+    RegisterLatencyServices<N>::run(c);
+    benchmark::DoNotOptimize(c.resolve<LatencyService<1> >());
+  }
+}
+BENCHMARK_TEMPLATE(BM_Container_RequestRebuild, 4);
+BENCHMARK_TEMPLATE(BM_Container_RequestRebuild, 16);
+
+template <int N>
+static void BM_Container_RequestChild(benchmark::State& state) {
+  Knot::Container parent;
+  RegisterLatencyServices<N>::run(parent);
+  for (auto _ : state) {
+    Knot::Container c(Knot::CHILD_OF, parent);
+    benchmark::DoNotOptimize(c.resolve<LatencyService<1> >());
+  }
+}
+BENCHMARK_TEMPLATE(BM_Container_RequestChild, 4);
+BENCHMARK_TEMPLATE(BM_Container_RequestChild, 16);
+
+static void BM_Container_ResolveSingletonFromChild(benchmark::State& state) {
+  Knot::Container parent;
+  parent.registerService<StaticBenchSingleton>(SINGLETON);
+  Knot::Container c(Knot::CHILD_OF, parent);
+  for (auto _ : state) {
+    StaticBenchSingleton* s = c.resolve<StaticBenchSingleton>();
+    benchmark::DoNotOptimize(s);
+  }
+}
+BENCHMARK(BM_Container_ResolveSingletonFromChild);
+
+struct RequestPart {
+  int x;
+  RequestPart() : x(0) {}
+};
+
+struct RequestContext {
+  int y;
+  RequestContext() : y(0) {}
+};
+
+static void BM_Container_RequestGraphTransient(benchmark::State& state) {
+  Knot::Container c;
+  c.registerService<RequestPart>(TRANSIENT);
+  c.registerService<RequestContext>(TRANSIENT);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(c.resolve<RequestPart>());
+    benchmark::DoNotOptimize(c.resolve<RequestContext>());
+    c.destroyAllTransients();
+  }
+}
+BENCHMARK(BM_Container_RequestGraphTransient);
+
+static void BM_Scope_RequestGraphScoped(benchmark::State& state) {
+  Knot::Container c;
+  c.registerService<RequestPart>(SCOPED);
+  c.registerService<RequestContext>(SCOPED);
+  Knot::Scope scope(c);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(scope.resolve<RequestPart>());
+    benchmark::DoNotOptimize(scope.resolve<RequestContext>());
+    scope.end();
+  }
+}
+BENCHMARK(BM_Scope_RequestGraphScoped);
+
+// Тот же граф запроса, но контейнер пересоздается ради освобождения памяти
+// временных сервисов, как без арены запроса.
+static void BM_Container_RequestGraphRebuild(benchmark::State& state) {
+  for (auto _ : state) {
+    Knot::Container c;
+    c.registerService<RequestPart>(TRANSIENT);
+    c.registerService<RequestContext>(TRANSIENT);
+    benchmark::DoNotOptimize(c.resolve<RequestPart>());
+    benchmark::DoNotOptimize(c.resolve<RequestContext>());
+  }
+}
+BENCHMARK(BM_Container_RequestGraphRebuild);
+
+static void BM_Container_RequestGraphArena(benchmark::State& state) {
+  Knot::Container c;
+  c.registerService<RequestPart>(TRANSIENT);
+  c.registerService<RequestContext>(TRANSIENT);
+  for (auto _ : state) {
+    c.beginRequest();
+    benchmark::DoNotOptimize(c.resolve<RequestPart>());
+    benchmark::DoNotOptimize(c.resolve<RequestContext>());
+    c.endRequest();
+  }
+}
+BENCHMARK(BM_Container_RequestGraphArena);
+
+struct LiveTransient {
+  int x;
+  LiveTransient() : x(0) {}
+};
+
+static void BM_Container_DestroyTransientByPointer(benchmark::State& state) {
+  const size_t live = static_cast<size_t>(state.range(0));
+  Knot::Container c(1 << 20);
+  c.registerService<LiveTransient>(TRANSIENT);
+  std::vector<LiveTransient*> ptrs(live);
+  for (size_t i = 0; i < live; ++i) ptrs[i] = c.resolve<LiveTransient>();
+  size_t i = 0;
+  for (auto _ : state) {
+    c.destroyTransient(ptrs[i]);
+    ptrs[i] = c.resolve<LiveTransient>();
+    i = (i + 1) % live;
+  }
+}
+BENCHMARK(BM_Container_DestroyTransientByPointer)->Arg(64)->Arg(4096);
+
+static void BM_Container_DestroyTransientByHandle(benchmark::State& state) {
+  const size_t live = static_cast<size_t>(state.range(0));
+  Knot::Container c(1 << 20);
+  c.registerService<LiveTransient>(TRANSIENT);
+  std::vector<Knot::TransientHandle> handles(live);
+  for (size_t i = 0; i < live; ++i) c.resolve<LiveTransient>(handles[i]);
+  size_t i = 0;
+  for (auto _ : state) {
+    c.destroyTransient(handles[i]);
+    c.resolve<LiveTransient>(handles[i]);
+    i = (i + 1) % live;
+  }
+}
+BENCHMARK(BM_Container_DestroyTransientByHandle)->Arg(64)->Arg(4096);
+
+struct SharedSingleton {
+  int x;
+  SharedSingleton() : x(1) {}
+};
+
+struct SharedTransient {
+  int x;
+  SharedTransient() : x(2) {}
+};
+
+static Knot::Container& SharedContainer() {
+  static Knot::Container c(1 << 20);
+  static bool registered = c.registerService<SharedSingleton>(SINGLETON) &&
+                           c.registerService<SharedTransient>(TRANSIENT) &&
+                           c.resolve<SharedSingleton>() != NULL;
+  (void)registered;
+  return c;
+}
+
+static void BM_Container_ResolveSingletonConcurrent(benchmark::State& state) {
+  Knot::Container& c = SharedContainer();
+  for (auto _ : state) {
+    SharedSingleton* s = c.resolve<SharedSingleton>();
+    benchmark::DoNotOptimize(s);
+  }
+}
+BENCHMARK(BM_Container_ResolveSingletonConcurrent)
+    ->Threads(1)
+    ->Threads(2)
+    ->Threads(4)
+    ->Threads(8);
+
+static void BM_Container_ResolveTransientConcurrent(benchmark::State& state) {
+  Knot::Container& c = SharedContainer();
+  for (auto _ : state) {
+    Knot::TransientHandle handle;
+    benchmark::DoNotOptimize(c.resolve<SharedTransient>(handle));
+    c.destroyTransient(handle);
+  }
+}
+BENCHMARK(BM_Container_ResolveTransientConcurrent)
+    ->Threads(1)
+    ->Threads(2)
+    ->Threads(4)
+    ->Threads(8);
+
+// Синглтон с искусственной задержкой конструктора (например, чтение
+// конфигурации или установка соединения).
+template <int N>
+struct SlowStartup {
+  SlowStartup() { usleep(1000); }
+};
+
+template <int N>
+struct SlowStartupMid {
+  SlowStartupMid(SlowStartup<2 * N>*, SlowStartup<2 * N + 1>*) {
+    usleep(1000);
+  }
+};
+
+struct SlowStartupRoot {
+  SlowStartupRoot(SlowStartupMid<0>*, SlowStartupMid<1>*, SlowStartupMid<2>*,
+                  SlowStartupMid<3>*) {
+    usleep(1000);
+  }
+};
+
+template <int N>
+struct RegisterSlowStartup {
+  static void run(Knot::Container& c) {
+    RegisterSlowStartup<N - 1>::run(c);
+    c.registerService<SlowStartup<2 * N> >(SINGLETON);
+    c.registerService<SlowStartup<2 * N + 1> >(SINGLETON);
+    c.registerService<SlowStartupMid<N> >(
+        SINGLETON, c.inject<SlowStartup<2 * N> >(),
+        c.inject<SlowStartup<2 * N + 1> >());
+  }
+};
+
+template <>
+struct RegisterSlowStartup<-1> {
+  static void run(Knot::Container&) {}
+};
+
+// 13 синглтонов в три уровня: 8 листьев, 4 промежуточных и корень.
+static void RegisterSlowStartupGraph(Knot::Container& c) {
+  RegisterSlowStartup<3>::run(c);
+  c.registerService<SlowStartupRoot>(
+      SINGLETON, c.inject<SlowStartupMid<0> >(), c.inject<SlowStartupMid<1> >(),
+      c.inject<SlowStartupMid<2> >(), c.inject<SlowStartupMid<3> >());
+}
+
+static void BM_Container_StartupSerial(benchmark::State& state) {
+  for (auto _ : state) {
+    Knot::Container c(1 << 16);
+    RegisterSlowStartupGraph(c);
+    benchmark::DoNotOptimize(c.resolve<SlowStartupRoot>());
+  }
+}
+BENCHMARK(BM_Container_StartupSerial)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_Container_StartupWarmUp(benchmark::State& state) {
+  for (auto _ : state) {
+    Knot::Container c(1 << 16);
+    RegisterSlowStartupGraph(c);
+    benchmark::DoNotOptimize(c.warmUp(static_cast<size_t>(state.range(0))));
+  }
+}
+BENCHMARK(BM_Container_StartupWarmUp)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Arg(8)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+struct FactoryBenchObject {
+  int x;
+  explicit FactoryBenchObject(int v) : x(v) {}
+};
+
+// Фабрика вызывается через указатель на интерфейс, как до размещения фабрик
+// в дескрипторах.
+static void BM_Factory_VirtualCreate(benchmark::State& state) {
+  Knot::IFactory* factory = new Knot::Factory1<FactoryBenchObject, int>(1);
+  benchmark::DoNotOptimize(factory);
+  Knot::AlignedStorage<sizeof(FactoryBenchObject)> buffer;
+  for (auto _ : state) {
+    void* obj = factory->create(buffer.data);
+    benchmark::DoNotOptimize(obj);
+    factory->destroy(obj);
+  }
+  delete factory;
+}
+BENCHMARK(BM_Factory_VirtualCreate);
+
+// Фабрика хранится в дескрипторе и вызывается через указатель на функцию.
+static void BM_Factory_InlineCreate(benchmark::State& state) {
+  Knot::Descriptor desc;
+  desc.setFactory(Knot::Factory1<FactoryBenchObject, int>(1));
+  benchmark::DoNotOptimize(&desc);
+  Knot::AlignedStorage<sizeof(FactoryBenchObject)> buffer;
+  for (auto _ : state) {
+    void* obj = desc.create(buffer.data);
+    benchmark::DoNotOptimize(obj);
+    desc.destroy(obj);
+  }
+}
+BENCHMARK(BM_Factory_InlineCreate);
+
+struct BatchItem {
+  int x;
+  BatchItem() : x(0) {}
+};
+
+static void BM_Container_ResolveTransientOneByOne(benchmark::State& state) {
+  const size_t count = static_cast<size_t>(state.range(0));
+  Knot::Container c(1 << 20);
+  c.registerService<BatchItem>(TRANSIENT);
+  for (auto _ : state) {
+    for (size_t i = 0; i < count; ++i)
+      benchmark::DoNotOptimize(c.resolve<BatchItem>());
+    c.destroyAllTransients();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Container_ResolveTransientOneByOne)->Arg(8)->Arg(64);
+
+static void BM_Container_ResolveTransientBatch(benchmark::State& state) {
+  const size_t count = static_cast<size_t>(state.range(0));
+  Knot::Container c(1 << 20);
+  c.registerService<BatchItem>(TRANSIENT);
+  std::vector<BatchItem*> items(count);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(c.resolveMany<BatchItem>(count, &items[0]));
+    c.destroyAllTransients();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Container_ResolveTransientBatch)->Arg(8)->Arg(64);
+
+// Цикл создания и уничтожения временного сервиса в куче: с пустым списком
+// повторного использования каждый цикл вызывает operator new/delete.
+static void BM_Container_TransientChurn(benchmark::State& state) {
+  Knot::Container c(1 << 20);
+  c.registerService<BatchItem>(TRANSIENT);
+  c.setRecycleLimit<BatchItem>(static_cast<size_t>(state.range(0)));
+  for (auto _ : state) {
+    Knot::TransientHandle handle;
+    benchmark::DoNotOptimize(c.resolve<BatchItem>(handle));
+    c.destroyTransient(handle);
+  }
+  Knot::RecycleStats stats = c.recycleStats<BatchItem>();
+  state.counters["hits"] = static_cast<double>(stats.hits);
+  state.counters["misses"] = static_cast<double>(stats.misses);
+}
+BENCHMARK(BM_Container_TransientChurn)->Arg(0)->Arg(16);
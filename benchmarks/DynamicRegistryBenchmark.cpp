@@ -0,0 +1,97 @@
+#include <benchmark/benchmark.h>
+
+#include "../include/knot-di/Container.hpp"
+
+// Собирается с KNOT_DYNAMIC_REGISTRY=1 и малым KNOT_MAX_TYPES, поэтому
+// почти все типы ищутся через хеш-таблицу реестра, а не через m_slots.
+
+template <int N>
+struct HashedService {
+  int x;
+  HashedService() : x(N) {}
+};
+
+template <int N>
+struct RegisterHashedServices {
+  static void run(Knot::Container& c) {
+    c.registerService<HashedService<N> >(SINGLETON);
+    RegisterHashedServices<N - 1>::run(c);
+  }
+};
+
+template <>
+struct RegisterHashedServices<0> {
+  static void run(Knot::Container&) {}
+};
+
+// HashedService<1> регистрируется последним: для линейного перебора это
+// худший случай, для хеш-таблицы стоимость не зависит от N.
+template <int N>
+static void BM_DynamicRegistry_ResolveLatency(benchmark::State& state) {
+  Knot::Container c(1 << 20);
+  RegisterHashedServices<N>::run(c);
+  for (auto _ : state) {
+    HashedService<1>* s = c.resolve<HashedService<1> >();
+    benchmark::DoNotOptimize(s);
+  }
+}
+BENCHMARK_TEMPLATE(BM_DynamicRegistry_ResolveLatency, 16);
+BENCHMARK_TEMPLATE(BM_DynamicRegistry_ResolveLatency, 64);
+BENCHMARK_TEMPLATE(BM_DynamicRegistry_ResolveLatency, 256);
+BENCHMARK_TEMPLATE(BM_DynamicRegistry_ResolveLatency, 512);
+
+// Тот же поиск после seal(): одно сравнение в совершенной хеш-таблице.
+template <int N>
+static void BM_DynamicRegistry_ResolveSealed(benchmark::State& state) {
+  Knot::Container c(1 << 20);
+  RegisterHashedServices<N>::run(c);
+  c.seal();
+  for (auto _ : state) {
+    HashedService<1>* s = c.resolve<HashedService<1> >();
+    benchmark::DoNotOptimize(s);
+  }
+}
+BENCHMARK_TEMPLATE(BM_DynamicRegistry_ResolveSealed, 16);
+BENCHMARK_TEMPLATE(BM_DynamicRegistry_ResolveSealed, 512);
+
+// Запечатывание реестра из N записей.
+template <int N>
+static void BM_DynamicRegistry_Seal(benchmark::State& state) {
+  for (auto _ : state) {
+    state.PauseTiming();
+    Knot::Container* c = new Knot::Container(1 << 20);
+    RegisterHashedServices<N>::run(*c);
+    state.ResumeTiming();
+    benchmark::DoNotOptimize(c->seal());
+    state.PauseTiming();
+    delete c;
+    state.ResumeTiming();
+  }
+}
+BENCHMARK_TEMPLATE(BM_DynamicRegistry_Seal, 64);
+BENCHMARK_TEMPLATE(BM_DynamicRegistry_Seal, 512);
+
+// Регистрация с ростом реестра и хеш-таблицы от начальной емкости.
+template <int N>
+static void BM_DynamicRegistry_Register(benchmark::State& state) {
+  for (auto _ : state) {
+    Knot::Container c(1 << 20);
+    RegisterHashedServices<N>::run(c);
+    benchmark::ClobberMemory();
+  }
+}
+BENCHMARK_TEMPLATE(BM_DynamicRegistry_Register, 64);
+BENCHMARK_TEMPLATE(BM_DynamicRegistry_Register, 512);
+
+static void BM_DynamicRegistry_TransientGrowth(benchmark::State& state) {
+  Knot::Container c(1 << 22);
+  c.registerService<HashedService<0> >(TRANSIENT);
+  for (auto _ : state) {
+    for (int64_t i = 0; i < state.range(0); ++i) {
+      HashedService<0>* s = c.resolve<HashedService<0> >();
+      benchmark::DoNotOptimize(s);
+    }
+    c.destroyAllTransients();
+  }
+}
+BENCHMARK(BM_DynamicRegistry_TransientGrowth)->Arg(64)->Arg(1024);
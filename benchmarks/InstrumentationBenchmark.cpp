@@ -0,0 +1,73 @@
+#include <benchmark/benchmark.h>
+
+#include "../include/knot-di/Container.hpp"
+#include "../include/knot-di/Scope.hpp"
+
+// Собирается в knot-di-benchmarks (KNOT_INSTRUMENTATION=0) и в
+// knot-di-benchmarks-instrumented (KNOT_INSTRUMENTATION=1). При выключенном
+// учете макрос KNOT_INSTRUMENT раскрывается в пустоту, а поля счетчиков не
+// объявляются; сравнение времени двух сборок показывает стоимость счетчиков.
+
+struct ProbeSingleton {
+  int x;
+  ProbeSingleton() : x(1) {}
+};
+
+struct ProbeTransient {
+  int x;
+  ProbeTransient() : x(2) {}
+};
+
+struct ProbeScoped {
+  int x;
+  ProbeScoped() : x(3) {}
+};
+
+static void BM_Instrumentation_ResolveSingleton(benchmark::State& state) {
+  Knot::Container c;
+  c.registerService<ProbeSingleton>(SINGLETON);
+  for (auto _ : state) {
+    ProbeSingleton* s = c.resolve<ProbeSingleton>();
+    benchmark::DoNotOptimize(s);
+  }
+}
+BENCHMARK(BM_Instrumentation_ResolveSingleton);
+
+static void BM_Instrumentation_ResolveTransient(benchmark::State& state) {
+  Knot::Container c;
+  c.registerService<ProbeTransient>(TRANSIENT);
+  for (auto _ : state) {
+    ProbeTransient* t = c.resolve<ProbeTransient>();
+    benchmark::DoNotOptimize(t);
+    c.destroyTransient(t);
+  }
+}
+BENCHMARK(BM_Instrumentation_ResolveTransient);
+
+static void BM_Instrumentation_ResolveScoped(benchmark::State& state) {
+  Knot::Container c(1 << 16);
+  c.registerService<ProbeScoped>(SCOPED);
+  Knot::Scope scope(c);
+  for (auto _ : state) {
+    ProbeScoped* s = scope.resolve<ProbeScoped>();
+    benchmark::DoNotOptimize(s);
+    scope.end();
+  }
+}
+BENCHMARK(BM_Instrumentation_ResolveScoped);
+
+#if KNOT_INSTRUMENTATION
+static void BM_Instrumentation_Snapshot(benchmark::State& state) {
+  Knot::Container c(1 << 16);
+  c.registerService<ProbeSingleton>(SINGLETON);
+  c.registerService<ProbeTransient>(TRANSIENT);
+  c.registerService<ProbeScoped>(SCOPED);
+  Knot::ServiceStats stats[3];
+  for (auto _ : state) {
+    size_t count = c.snapshotStats(stats, 3);
+    benchmark::DoNotOptimize(count);
+    benchmark::DoNotOptimize(stats);
+  }
+}
+BENCHMARK(BM_Instrumentation_Snapshot);
+#endif
@@ -1,5 +1,7 @@
 #include <benchmark/benchmark.h>
 
+#include <vector>
+
 #include "../include/knot-di/MemoryPool.hpp"
 
 static void BM_MemoryPool_AllocateDeallocate(benchmark::State& state) {
@@ -46,3 +48,100 @@ static void BM_MemoryPool_Reset(benchmark::State& state) {
   }
 }
 BENCHMARK(BM_MemoryPool_Reset);
+
+static void BM_MemoryPool_BufferChurn(benchmark::State& state) {
+  alignas(16) static char buffer[4096];
+  Knot::MemoryPool pool(buffer);
+  const size_t kLive = 16;
+  void* ptrs[kLive] = {};
+  size_t sizes[kLive] = {};
+  unsigned seed = 1;
+  size_t slot = 0;
+  for (auto _ : state) {
+    if (ptrs[slot]) pool.deallocate(ptrs[slot], sizes[slot]);
+    seed = seed * 1103515245u + 12345u;
+    sizes[slot] = 8 + (seed >> 16) % 192;
+    ptrs[slot] = pool.allocateRaw(sizes[slot], (seed >> 8) % 2 ? 8 : 16);
+    if (!ptrs[slot]) {
+      state.SkipWithError("buffer pool exhausted");
+      break;
+    }
+    benchmark::DoNotOptimize(ptrs[slot]);
+    slot = (slot + 1) % kLive;
+  }
+}
+BENCHMARK(BM_MemoryPool_BufferChurn)->Iterations(5000000);
+
+// live блоков по 48 байт выделяются и освобождаются в обратном порядке, как
+// временные сервисы контейнера.
+static void RunHeapChurn(Knot::MemoryPool& pool, benchmark::State& state,
+                         int64_t live) {
+  std::vector<void*> ptrs(static_cast<size_t>(live));
+  for (auto _ : state) {
+    for (int64_t i = 0; i < live; ++i) {
+      ptrs[i] = pool.allocateRaw(48, 8);
+      benchmark::DoNotOptimize(ptrs[i]);
+    }
+    for (int64_t i = live; i-- > 0;) pool.deallocate(ptrs[i], 48);
+  }
+  state.SetItemsProcessed(state.iterations() * live);
+}
+
+// chunk - размер первого блока кучи; 0 - вызов operator new на каждое
+// выделение.
+static void BM_MemoryPool_HeapChurn(benchmark::State& state) {
+  Knot::MemoryPool pool(1 << 24, static_cast<size_t>(state.range(0)));
+  RunHeapChurn(pool, state, state.range(1));
+}
+BENCHMARK(BM_MemoryPool_HeapChurn)
+    ->ArgNames({"chunk", "live"})
+    ->ArgsProduct({{0, 65536}, {1, 16, 1024}});
+
+#if KNOT_POOL_MMAP
+static void BM_MemoryPool_MappedChurn(benchmark::State& state) {
+  Knot::MemoryPool pool(1 << 24, Knot::MemoryPool::RESERVE);
+  RunHeapChurn(pool, state, state.range(0));
+}
+BENCHMARK(BM_MemoryPool_MappedChurn)
+    ->ArgName("live")
+    ->Arg(1)
+    ->Arg(16)
+    ->Arg(1024);
+
+// Случайное чтение таблицы в 256 МБ, как у синглтона-кэша. mapped - таблица
+// в области mmap с MADV_HUGEPAGE, иначе в блоке кучи: разница - промахи TLB.
+static void BM_MemoryPool_LargeTableRead(benchmark::State& state) {
+  const size_t cells = (256u << 20) / sizeof(uint64_t);
+  Knot::MemoryPool pool((256u << 20) + 4096,
+                        state.range(0) ? Knot::MemoryPool::RESERVE
+                                       : KNOT_POOL_CHUNK_BYTES);
+  uint64_t* table = static_cast<uint64_t*>(pool.allocate<uint64_t>(cells));
+  if (!table) {
+    state.SkipWithError("table allocation failed");
+    return;
+  }
+  for (size_t i = 0; i < cells; ++i) table[i] = i;
+  uint64_t seed = 1;
+  uint64_t sum = 0;
+  for (auto _ : state) {
+    seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+    sum += table[(seed >> 20) % cells];
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MemoryPool_LargeTableRead)->ArgName("mapped")->Arg(0)->Arg(1);
+
+// Заполнение 8 МБ блоками по 4 КБ и reset(): блоки кучи возвращаются в кучу,
+// область mmap отдает страницы через MADV_DONTNEED и заполняется заново.
+static void BM_MemoryPool_FillReset(benchmark::State& state) {
+  Knot::MemoryPool pool(8 << 20, state.range(0) ? Knot::MemoryPool::RESERVE
+                                                : KNOT_POOL_CHUNK_BYTES);
+  for (auto _ : state) {
+    while (void* page = pool.allocateRaw(4096, 4096))
+      *static_cast<volatile char*>(page) = 1;
+    pool.reset();
+  }
+}
+BENCHMARK(BM_MemoryPool_FillReset)->ArgName("mapped")->Arg(0)->Arg(1);
+#endif
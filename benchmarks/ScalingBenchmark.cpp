@@ -0,0 +1,272 @@
+#include <benchmark/benchmark.h>
+
+#include <new>
+
+#include "../include/knot-di/Container.hpp"
+#include "../include/knot-di/Scope.hpp"
+
+// Параметризованный набор: контейнер и регистрации создаются до цикла,
+// поэтому замеряется только разрешение. Аргументы:
+//   services - число зарегистрированных сервисов, по которым идут запросы;
+//   strategy - значение Strategy (0 SINGLETON, 1 TRANSIENT, 3 SCOPED);
+//   buffer   - 0 для пула в куче, 1 для пула во внешнем буфере;
+//   threads  - число потоков, разделяющих контейнер.
+// Baseline_* задают нижнюю границу: те же объекты через new и placement new.
+
+enum { MAX_SCALED_SERVICES = 256 };  // Верхняя граница аргумента services
+
+template <int N>
+struct ScaledService {
+  int x;
+  ScaledService() : x(N) {}
+};
+
+// Разрешение одного сервиса. Для TRANSIENT экземпляр сразу уничтожается,
+// для остальных стратегий handle остается недействительным (generation 0).
+template <int N>
+static void TouchScaled(Knot::Container& c) {
+  Knot::TransientHandle handle;
+  benchmark::DoNotOptimize(c.resolve<ScaledService<N> >(handle));
+  if (handle.generation) c.destroyTransient(handle);
+}
+
+typedef void (*TouchFn)(Knot::Container&);
+typedef bool (*RegisterFn)(Knot::Container&, Strategy);
+
+template <int N>
+static bool RegisterScaled(Knot::Container& c, Strategy strategy) {
+  return c.registerService<ScaledService<N> >(strategy);
+}
+
+// Таблицы функций для ScaledService<0>..ScaledService<N - 1>: число
+// сервисов задается аргументом бенчмарка во время выполнения.
+template <int N>
+struct ScaledTable {
+  static void fill(TouchFn* touch, RegisterFn* add) {
+    ScaledTable<N - 1>::fill(touch, add);
+    touch[N - 1] = &TouchScaled<N - 1>;
+    add[N - 1] = &RegisterScaled<N - 1>;
+  }
+};
+
+template <>
+struct ScaledTable<0> {
+  static void fill(TouchFn*, RegisterFn*) {}
+};
+
+struct ScaledServices {
+  TouchFn touch[MAX_SCALED_SERVICES];
+  RegisterFn add[MAX_SCALED_SERVICES];
+
+  ScaledServices() { ScaledTable<MAX_SCALED_SERVICES>::fill(touch, add); }
+
+  static const ScaledServices& get() {
+    static const ScaledServices table;
+    return table;
+  }
+};
+
+static void BM_Scaling_Register(benchmark::State& state) {
+  const ScaledServices& table = ScaledServices::get();
+  const int64_t services = state.range(0);
+  for (auto _ : state) {
+    Knot::Container c(1 << 20);
+    for (int64_t i = 0; i < services; ++i) table.add[i](c, SINGLETON);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * services);
+}
+BENCHMARK(BM_Scaling_Register)
+    ->ArgName("services")
+    ->RangeMultiplier(4)
+    ->Range(1, MAX_SCALED_SERVICES);
+
+// Запросы по кругу ко всем зарегистрированным сервисам: с ростом числа
+// сервисов растет рабочий набор записей реестра и фабрик.
+static void BM_Scaling_Resolve(benchmark::State& state) {
+  const ScaledServices& table = ScaledServices::get();
+  const int64_t services = state.range(0);
+  Strategy strategy = static_cast<Strategy>(state.range(1));
+  Knot::Container c(1 << 20);
+  for (int64_t i = 0; i < services; ++i) table.add[i](c, strategy);
+  c.warmUp();
+  int64_t next = 0;
+  for (auto _ : state) {
+    table.touch[next](c);
+    if (++next == services) next = 0;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Scaling_Resolve)
+    ->ArgNames({"services", "strategy"})
+    ->ArgsProduct({benchmark::CreateRange(1, MAX_SCALED_SERVICES, 4),
+                   {SINGLETON, TRANSIENT}});
+
+// Уничтожение синглтонов, когда из services зарегистрированных создан
+// один: стоимость должна зависеть от созданных, а не от регистраций.
+static void BM_Scaling_DestroySingletons(benchmark::State& state) {
+  const ScaledServices& table = ScaledServices::get();
+  const int64_t services = state.range(0);
+  Knot::Container c(1 << 20);
+  for (int64_t i = 0; i < services; ++i) table.add[i](c, SINGLETON);
+  for (auto _ : state) {
+    table.touch[0](c);
+    c.destroyAllSingletons();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Scaling_DestroySingletons)
+    ->ArgName("services")
+    ->RangeMultiplier(4)
+    ->Range(1, MAX_SCALED_SERVICES);
+
+// Сервис с N аргументами конструктора, регистрируется через FactoryN.
+template <int N>
+struct ArityService {
+  int sum;
+  ArityService(int a1, int a2 = 0, int a3 = 0, int a4 = 0, int a5 = 0,
+               int a6 = 0, int a7 = 0, int a8 = 0)
+      : sum(a1 + a2 + a3 + a4 + a5 + a6 + a7 + a8) {}
+};
+
+template <int N>
+struct Arity;
+
+// Регистрация и прямое создание ArityService<N> с N аргументами.
+#define ARITY_SERVICE(N, ...)                                       \
+  template <>                                                       \
+  struct Arity<N> {                                                 \
+    static bool add(Knot::Container& c, Strategy strategy) {        \
+      return c.registerService<ArityService<N> >(strategy,          \
+                                                 __VA_ARGS__);      \
+    }                                                               \
+    static ArityService<N>* make(void* buffer) {                    \
+      return buffer ? new (buffer) ArityService<N>(__VA_ARGS__)     \
+                    : new ArityService<N>(__VA_ARGS__);             \
+    }                                                               \
+  };
+
+ARITY_SERVICE(1, 1)
+ARITY_SERVICE(2, 1, 2)
+ARITY_SERVICE(3, 1, 2, 3)
+ARITY_SERVICE(4, 1, 2, 3, 4)
+ARITY_SERVICE(5, 1, 2, 3, 4, 5)
+ARITY_SERVICE(6, 1, 2, 3, 4, 5, 6)
+ARITY_SERVICE(7, 1, 2, 3, 4, 5, 6, 7)
+ARITY_SERVICE(8, 1, 2, 3, 4, 5, 6, 7, 8)
+
+#undef ARITY_SERVICE
+
+// Полный цикл жизни экземпляра: для TRANSIENT - создание и уничтожение,
+// для SCOPED - создание в области и end(), для SINGLETON - чтение кэша.
+template <int N>
+static void BM_Scaling_Arity(benchmark::State& state) {
+  Strategy strategy = static_cast<Strategy>(state.range(0));
+  Knot::Container c(1 << 20);
+  Arity<N>::add(c, strategy);
+  Knot::Scope scope(c);
+  for (auto _ : state) {
+    if (strategy == SCOPED) {
+      benchmark::DoNotOptimize(scope.resolve<ArityService<N> >());
+      scope.end();
+    } else {
+      Knot::TransientHandle handle;
+      benchmark::DoNotOptimize(c.resolve<ArityService<N> >(handle));
+      if (handle.generation) c.destroyTransient(handle);
+    }
+  }
+}
+
+#define ARITY_STRATEGIES \
+  ArgName("strategy")->Arg(SINGLETON)->Arg(TRANSIENT)->Arg(SCOPED)
+
+BENCHMARK_TEMPLATE(BM_Scaling_Arity, 1)->ARITY_STRATEGIES;
+BENCHMARK_TEMPLATE(BM_Scaling_Arity, 2)->ARITY_STRATEGIES;
+BENCHMARK_TEMPLATE(BM_Scaling_Arity, 3)->ARITY_STRATEGIES;
+BENCHMARK_TEMPLATE(BM_Scaling_Arity, 4)->ARITY_STRATEGIES;
+BENCHMARK_TEMPLATE(BM_Scaling_Arity, 5)->ARITY_STRATEGIES;
+BENCHMARK_TEMPLATE(BM_Scaling_Arity, 6)->ARITY_STRATEGIES;
+BENCHMARK_TEMPLATE(BM_Scaling_Arity, 7)->ARITY_STRATEGIES;
+BENCHMARK_TEMPLATE(BM_Scaling_Arity, 8)->ARITY_STRATEGIES;
+
+#undef ARITY_STRATEGIES
+
+template <int N>
+static void BM_Baseline_New(benchmark::State& state) {
+  for (auto _ : state) {
+    ArityService<N>* instance = Arity<N>::make(NULL);
+    benchmark::DoNotOptimize(instance);
+    delete instance;
+  }
+}
+BENCHMARK_TEMPLATE(BM_Baseline_New, 1);
+BENCHMARK_TEMPLATE(BM_Baseline_New, 8);
+
+template <int N>
+static void BM_Baseline_PlacementNew(benchmark::State& state) {
+  alignas(ArityService<N>) unsigned char buffer[sizeof(ArityService<N>)];
+  for (auto _ : state) {
+    ArityService<N>* instance = Arity<N>::make(buffer);
+    benchmark::DoNotOptimize(instance);
+    instance->~ArityService<N>();
+    benchmark::ClobberMemory();
+  }
+}
+BENCHMARK_TEMPLATE(BM_Baseline_PlacementNew, 1);
+BENCHMARK_TEMPLATE(BM_Baseline_PlacementNew, 8);
+
+// Создание и уничтожение TRANSIENT сервиса при live живых экземплярах:
+// сравнение пула в куче со списками свободных блоков буфера.
+static void RunPoolMode(Knot::Container& c, benchmark::State& state) {
+  const int64_t live = state.range(1);
+  c.registerService<ArityService<4> >(TRANSIENT, 1, 2, 3, 4);
+  for (int64_t i = 0; i < live; ++i) c.resolve<ArityService<4> >();
+  for (auto _ : state) {
+    Knot::TransientHandle handle;
+    benchmark::DoNotOptimize(c.resolve<ArityService<4> >(handle));
+    c.destroyTransient(handle);
+  }
+}
+
+static void BM_Scaling_PoolMode(benchmark::State& state) {
+  alignas(16) static uint8_t buffer[1 << 20];
+  if (state.range(0)) {
+    Knot::Container c(buffer);
+    RunPoolMode(c, state);
+  } else {
+    Knot::Container c(sizeof(buffer));
+    RunPoolMode(c, state);
+  }
+}
+BENCHMARK(BM_Scaling_PoolMode)
+    ->ArgNames({"buffer", "live"})
+    ->ArgsProduct({{0, 1}, {0, 64, 1024}});
+
+// Общий контейнер для всех потоков. Его создает поток 0 до цикла и
+// уничтожает после: цикл бенчмарка начинается и заканчивается барьером.
+static Knot::Container* g_shared = NULL;
+
+static void BM_Scaling_Concurrent(benchmark::State& state) {
+  const ScaledServices& table = ScaledServices::get();
+  const int64_t services = state.range(0);
+  Strategy strategy = static_cast<Strategy>(state.range(1));
+  if (state.thread_index() == 0) {
+    g_shared = new Knot::Container(1 << 20);
+    for (int64_t i = 0; i < services; ++i) table.add[i](*g_shared, strategy);
+    g_shared->warmUp();
+  }
+  int64_t next = state.thread_index() % services;
+  for (auto _ : state) {
+    table.touch[next](*g_shared);
+    if (++next == services) next = 0;
+  }
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index() == 0) {
+    delete g_shared;
+    g_shared = NULL;
+  }
+}
+BENCHMARK(BM_Scaling_Concurrent)
+    ->ArgNames({"services", "strategy"})
+    ->ArgsProduct({{1, 64}, {SINGLETON, TRANSIENT}})
+    ->ThreadRange(1, 8);
@@ -12,165 +12,1351 @@
 #define CONTAINER_HPP
 
 #include <cstddef>
+#include <cstring>
 #include <new>
 
-#include "ContainerMacros.hpp"
-#include "Descriptor.hpp"
-#include "Factory.hpp"
-#include "MemoryPool.hpp"
-#include "Strategy.hpp"
-#include "Util.hpp"
-
+// Настройки задаются до подключения остальных заголовков: от
+// KNOT_INSTRUMENTATION зависит состав Descriptor.
 #ifndef KNOT_MAX_SERVICES
 #define KNOT_MAX_SERVICES 16
 #endif
 
+// Счетчики разрешений и созданий для каждой записи реестра (ServiceStats).
+// При значении 0 код учета не компилируется вовсе.
+#ifndef KNOT_INSTRUMENTATION
+#define KNOT_INSTRUMENTATION 0
+#endif
+
 #ifndef KNOT_MAX_TRANSIENTS
 #define KNOT_MAX_TRANSIENTS 32
 #endif
 
+#ifndef KNOT_MAX_TYPES
+#define KNOT_MAX_TYPES 64
+#endif
+
+// Динамический реестр: записи и хеш-таблица выделяются из пула и растут по
+// мере регистрации. KNOT_MAX_SERVICES и KNOT_MAX_TRANSIENTS в этом режиме
+// задают начальную емкость, а не предел.
+#ifndef KNOT_DYNAMIC_REGISTRY
+#define KNOT_DYNAMIC_REGISTRY 0
+#endif
+
+// Начальная емкость журнала созданий в динамическом режиме, в записях.
+#ifndef KNOT_CREATION_LOG_SIZE
+#define KNOT_CREATION_LOG_SIZE 8
+#endif
+
+// Размер первого блока пула дочернего контейнера, в байтах. Пул не выделяет
+// память до первой регистрации или первого TRANSIENT экземпляра и дальше
+// растет вдвое, поэтому дочерний контейнер, который только обращается к
+// родителю, памяти из кучи не занимает.
+#ifndef KNOT_CHILD_POOL_CHUNK_BYTES
+#define KNOT_CHILD_POOL_CHUNK_BYTES 256
+#endif
+
+// Размер арены запроса по умолчанию для beginRequest(), в байтах.
+#ifndef KNOT_REQUEST_ARENA_BYTES
+#define KNOT_REQUEST_ARENA_BYTES 4096
+#endif
+
+// Количество регистраций с ключом ServiceKey в режиме фиксированного реестра.
+// В динамическом режиме регистрации с ключом хранятся в общей хеш-таблице.
+#ifndef KNOT_MAX_KEYED_SERVICES
+#define KNOT_MAX_KEYED_SERVICES KNOT_MAX_SERVICES
+#endif
+
+#include "ContainerMacros.hpp"
+#include "Descriptor.hpp"
+#include "Factory.hpp"
+#include "MemoryPool.hpp"
+#include "Strategy.hpp"
+#include "Sync.hpp"
+#include "Util.hpp"
+
 namespace Knot {
 
+/** @brief Тег конструктора дочернего контейнера
+ * @details Отделяет создание дочернего контейнера от копирования:
+ * Container child(CHILD_OF, parent).
+ */
+enum ChildOf { CHILD_OF };
+
+class Scope;
+template <typename D>
+class Inject;
+template <typename T>
+class ServiceRef;
+template <typename D>
+class Lazy;
+
+/** @brief Область видимости, активная в текущем потоке
+ * @details Scope делает себя активной на время разрешения сервиса, и SCOPED
+ * зависимости, которые фабрика разрешает через контейнер, создаются в той же
+ * области видимости. Класс Scope здесь еще не определен, поэтому контейнер
+ * обращается к нему через указатель на функцию.
+ */
+struct ActiveScope {
+  void* scope;  // Активная область видимости или NULL
+  void* (*resolve)(void* scope, RegistryEntry* entry);  // Создание SCOPED
+};
+
+/** @brief Активная область видимости текущего потока
+ * @return Ссылка на запись, отдельную для каждого потока.
+ */
+inline ActiveScope& CurrentScope() {
+  static KNOT_THREAD_LOCAL ActiveScope active;  // Область текущего потока
+  return active;
+}
+
 /** @brief Контейнер для управления сервисами
  *
  * Этот класс предоставляет функциональность для регистрации и разрешения
  * сервисов, а также управления их жизненным циклом. Он поддерживает стратегии
  * синглтона и временных сервисов, а также использует MemoryPool для управления
  * памятью.
+ *
+ * @note При KNOT_THREAD_SAFE=1 resolve и уничтожение сервисов можно вызывать
+ * из нескольких потоков. Разрешение созданного синглтона выполняется без
+ * блокировок: одно чтение указателя с семантикой acquire. Регистрация
+ * сервисов должна завершиться до начала параллельной работы; seal()
+ * закрепляет это, запрещая дальнейшую регистрацию.
+ *
+ * @note По умолчанию реестр и таблица временных сервисов - массивы внутри
+ * объекта контейнера, размер которых задается KNOT_MAX_SERVICES и
+ * KNOT_MAX_TRANSIENTS. При KNOT_DYNAMIC_REGISTRY=1 они выделяются из пула
+ * контейнера и удваиваются при заполнении, а типы за пределами таблицы
+ * m_slots ищутся в хеш-таблице с открытой адресацией вместо линейного
+ * перебора.
  */
 class Container {
  private:
+  friend class Scope;  // Области видимости используют реестр и пул контейнера
+  template <typename T>
+  friend class ServiceRef;  // Ссылки разрешают сервис по найденной записи
+
   Container(const Container&);             // Запрет копирования контейнера
   Container& operator=(const Container&);  // Запрет присваивания контейнера
 
   size_t m_service_count;    // Количество зарегистрированных сервисов
-  size_t m_factory_count;    // Количество зарегистрированных фабрик
   size_t m_transient_count;  // Количество временных сервисов
+  size_t m_transient_high;   // Количество когда-либо занятых записей
+                             // временных сервисов
+  size_t m_free_transient_count;  // Количество свободных записей в стеке
 
   MemoryPool m_pool;  // Пул памяти для управления памятью сервисов
+  Mutex m_mutex;      // Защищает пул и временные сервисы (KNOT_THREAD_SAFE)
+
+  RegistrySlot* m_table;  // Хеш-таблица: (тип, ключ) -> запись
+  size_t m_table_size;    // Количество ячеек, степень двойки
+  size_t m_table_shift;   // Сдвиг хеша до номера ячейки
+
+  bool m_sealed;               // Реестр запечатан, регистрация запрещена
+  SealedTable m_sealed_table;  // Совершенная хеш-таблица после seal()
+
+  Container* m_parent;  // Родительский контейнер или NULL
+  size_t m_index_base;  // Номер первой собственной записи: записи
+                        // родителей нумеруются раньше
+  size_t m_children;    // Количество живых дочерних контейнеров
+
+  /** @brief Запись журнала экземпляров запроса
+   * @details Размещается в арене запроса перед экземпляром. Записи связаны
+   * от последней к первой, поэтому endRequest() обходит их в порядке,
+   * обратном созданию.
+   */
+  struct RequestRecord {
+    RequestRecord* prev;     // Предыдущая запись или NULL
+    TransientHandle handle;  // Дескриптор временного сервиса
+  };
+
+  void* m_request_region;         // Область пула под арену запроса или NULL
+  size_t m_request_region_size;   // Размер области в байтах
+  MemoryPool m_request_arena;     // Арена экземпляров текущего запроса
+  RequestRecord* m_request_log;   // Последняя запись журнала запроса
+  bool m_in_request;              // Запрос начат beginRequest()
+
+  size_t m_creation_count;    // Количество записей журнала созданий
+  size_t m_creation_pending;  // Записи, зарезервированные для создаваемых
+                              // экземпляров
 
-  RegistryEntry
-      m_registry[KNOT_MAX_SERVICES];  // Реестр зарегистрированных сервисов
-  IFactory* m_factories[KNOT_MAX_SERVICES];  // Массив фабрик для сервисов
+#if KNOT_DYNAMIC_REGISTRY
+  RegistryEntry** m_registry;    // Записи реестра в порядке регистрации
+  size_t m_registry_capacity;    // Емкость массива m_registry
+  RegistryEntry* m_spare_entry;  // Память для следующей записи реестра
+  TransientInfo* m_transients;   // Массив временных сервисов
+  size_t* m_free_transients;     // Стек свободных записей
+  size_t m_transient_capacity;   // Емкость массивов временных сервисов
+  CreationRecord* m_creation_log;  // Журнал созданий в порядке создания
+  size_t m_creation_capacity;      // Емкость журнала созданий
+#else
+  AlignedStorage<sizeof(RegistryEntry) * KNOT_MAX_SERVICES>
+      m_registry_storage;  // Память реестра; записи создаются при регистрации
+  RegistryEntry* const m_registry;  // Реестр зарегистрированных сервисов
   TransientInfo m_transients[KNOT_MAX_TRANSIENTS];  // Массив временных сервисов
+  size_t m_free_transients[KNOT_MAX_TRANSIENTS];  // Стек свободных записей
+
+  // Живых записей не больше, чем синглтонов и временных сервисов вместе,
+  // поэтому сжатие заполненного журнала освобождает не меньше половины.
+  enum { CREATION_LOG_SIZE = 2 * (KNOT_MAX_SERVICES + KNOT_MAX_TRANSIENTS) };
+  CreationRecord m_creation_log[CREATION_LOG_SIZE];  // Журнал созданий в
+                                                     // порядке создания
+
+  enum {
+    KEYED_TABLE_SIZE = PowerOfTwoAtLeast<2 * KNOT_MAX_KEYED_SERVICES>::value
+  };
+  size_t m_keyed_count;  // Количество регистраций с ключом
+  AlignedStorage<sizeof(RegistrySlot) * KEYED_TABLE_SIZE>
+      m_table_storage;  // Хеш-таблица регистраций с ключом; очищается при
+                        // первой такой регистрации
+#endif
+  RegistryEntry* m_slots[KNOT_MAX_TYPES];  // Прямая таблица: индекс типа ->
+                                           // запись реестра
+
+  /** @brief метод для подключения пустой хеш-таблицы
+   * @param table Память для size ячеек
+   * @param size Количество ячеек, степень двойки
+   */
+  void set_table(void* table, size_t size) {
+    std::memset(table, 0, sizeof(RegistrySlot) * size);
+    m_table = static_cast<RegistrySlot*>(table);
+    m_table_size = size;
+    m_table_shift = hash_shift(size);
+  }
+
+  /** @brief Сдвиг хеша до номера ячейки таблицы
+   * @param size Количество ячеек, степень двойки
+   * @return Разрядность size_t минус log2(size)
+   */
+  static size_t hash_shift(size_t size) {
+    size_t shift = sizeof(size_t) * 8;
+    for (size_t n = size; n > 1; n >>= 1) --shift;
+    return shift;
+  }
+
+  /** @brief метод для вставки записи в хеш-таблицу
+   * @details Линейное пробирование: ячейки проверяются подряд, начиная с
+   * хеша, до первой свободной. Таблица заполнена не более чем наполовину,
+   * поэтому свободная ячейка всегда есть.
+   * @param entry Запись реестра
+   */
+  void insert_slot(RegistryEntry* entry) {
+    size_t mask = m_table_size - 1;
+    size_t i = HashTypeId(entry->type, entry->key) >> m_table_shift;
+    while (m_table[i].type) i = (i + 1) & mask;
+    m_table[i].type = entry->type;
+    m_table[i].key = entry->key;
+    m_table[i].entry = entry;
+  }
 
-  /** @brief метод для поиска записи в реестре по идентификатору типа
+  /** @brief метод для поиска записи в хеш-таблице
+   * @details Пара (тип, ключ) хранится в самой ячейке, поэтому найденная
+   * запись обычно определяется первым же сравнением.
+   * @param tid Указатель на идентификатор типа
+   * @param key Значение ключа или 0
+   * @return Указатель на найденную запись или NULL, если запись не найдена
+   */
+  RegistryEntry* find_slot(const void* tid, size_t key) const {
+    if (!m_table) return NULL;
+    size_t mask = m_table_size - 1;
+    for (size_t i = HashTypeId(tid, key) >> m_table_shift;;
+         i = (i + 1) & mask) {
+      const RegistrySlot& slot = m_table[i];
+      if (slot.type == tid && slot.key == key) return slot.entry;
+      if (!slot.type) return NULL;
+    }
+  }
+
+#if KNOT_DYNAMIC_REGISTRY
+  /** @brief метод для получения записи реестра по номеру
+   * @param i Номер записи в порядке регистрации
+   * @return Ссылка на запись
+   */
+  RegistryEntry& entry_at(size_t i) { return *m_registry[i]; }
+
+  /** @brief Емкость таблицы временных сервисов
+   */
+  size_t transient_capacity() const { return m_transient_capacity; }
+
+  /** @brief Емкость журнала созданий
+   */
+  size_t creation_capacity() const { return m_creation_capacity; }
+
+  /** @brief метод для увеличения журнала созданий
+   * @details Журнал растет вдвое по мере надобности, начиная с
+   * KNOT_CREATION_LOG_SIZE записей, а не резервируется под худший случай.
+   * @return true, если журнал увеличен
+   */
+  bool grow_creations() {
+    size_t capacity = m_creation_capacity ? m_creation_capacity * 2
+                                          : KNOT_CREATION_LOG_SIZE;
+    void* mem = m_pool.allocateRaw(sizeof(CreationRecord) * capacity,
+                                   AlignmentOf<CreationRecord>::value);
+    if (!mem) return false;
+    if (m_creation_log) {
+      std::memcpy(mem, m_creation_log,
+                  sizeof(CreationRecord) * m_creation_count);
+      m_pool.deallocate(m_creation_log,
+                        sizeof(CreationRecord) * m_creation_capacity);
+    }
+    m_creation_log = static_cast<CreationRecord*>(mem);
+    m_creation_capacity = capacity;
+    return true;
+  }
+
+  /** @brief метод для увеличения хеш-таблицы вдвое
+   * @details Новая таблица выделяется из пула и заполняется заново, старая
+   * возвращается в пул.
+   * @return true, если таблица увеличена
+   */
+  bool grow_table() {
+    size_t size = m_table_size ? m_table_size * 2 : 16;
+    void* mem = m_pool.allocateRaw(sizeof(RegistrySlot) * size,
+                                   AlignmentOf<RegistrySlot>::value);
+    if (!mem) return false;
+    if (m_table)
+      m_pool.deallocate(m_table, sizeof(RegistrySlot) * m_table_size);
+    set_table(mem, size);
+    for (size_t i = 0; i < m_service_count; ++i) insert_slot(m_registry[i]);
+    return true;
+  }
+
+  /** @brief метод для увеличения массива записей реестра вдвое
+   * @details Записи не перемещаются, копируются только указатели на них,
+   * поэтому указатели на дескрипторы остаются действительными.
+   * @return true, если массив увеличен
+   */
+  bool grow_registry() {
+    size_t capacity =
+        m_registry_capacity ? m_registry_capacity * 2 : KNOT_MAX_SERVICES;
+    void* mem = m_pool.allocateRaw(sizeof(RegistryEntry*) * capacity,
+                                   AlignmentOf<RegistryEntry*>::value);
+    if (!mem) return false;
+    if (m_registry) {
+      std::memcpy(mem, m_registry, sizeof(RegistryEntry*) * m_service_count);
+      m_pool.deallocate(m_registry,
+                        sizeof(RegistryEntry*) * m_registry_capacity);
+    }
+    m_registry = static_cast<RegistryEntry**>(mem);
+    m_registry_capacity = capacity;
+    return true;
+  }
+
+  /** @brief метод для увеличения таблицы временных сервисов вдвое
+   * @details Вызывается под блокировкой m_mutex. Записи копируются в новые
+   * массивы, поэтому индексы в выданных дескрипторах сохраняются.
+   * @return true, если таблица увеличена
+   */
+  bool grow_transients() {
+    size_t capacity =
+        m_transient_capacity ? m_transient_capacity * 2 : KNOT_MAX_TRANSIENTS;
+    void* infos = m_pool.allocateRaw(sizeof(TransientInfo) * capacity,
+                                     AlignmentOf<TransientInfo>::value);
+    if (!infos) return false;
+    void* free_list = m_pool.allocateRaw(sizeof(size_t) * capacity,
+                                         AlignmentOf<size_t>::value);
+    if (!free_list) {
+      m_pool.deallocate(infos, sizeof(TransientInfo) * capacity);
+      return false;
+    }
+    std::memset(infos, 0, sizeof(TransientInfo) * capacity);
+    if (m_transients) {
+      std::memcpy(infos, m_transients,
+                  sizeof(TransientInfo) * m_transient_high);
+      std::memcpy(free_list, m_free_transients,
+                  sizeof(size_t) * m_free_transient_count);
+      release_transient_arrays();
+    }
+    m_transients = static_cast<TransientInfo*>(infos);
+    m_free_transients = static_cast<size_t*>(free_list);
+    m_transient_capacity = capacity;
+    return true;
+  }
+
+  /** @brief метод для возврата массивов временных сервисов в пул
+   */
+  void release_transient_arrays() {
+    m_pool.deallocate(m_transients,
+                      sizeof(TransientInfo) * m_transient_capacity);
+    m_pool.deallocate(m_free_transients, sizeof(size_t) * m_transient_capacity);
+  }
+
+  /** @brief метод для подготовки места под новую запись реестра
+   * @details Увеличивает массив записей и хеш-таблицу, если это нужно, и
+   * заранее выделяет память для записи. Если регистрация затем не
+   * состоится, память остается в m_spare_entry для следующей записи.
+   * @return true, если место для записи есть, реестр не запечатан и у
+   * контейнера нет дочерних контейнеров
+   */
+  bool reserve_entry() {
+    if (m_sealed || LoadAcquire(&m_children)) return false;
+    if (m_service_count == m_registry_capacity && !grow_registry())
+      return false;
+    if ((m_service_count + 1) * 2 > m_table_size && !grow_table())
+      return false;
+    if (!m_spare_entry)
+      m_spare_entry = static_cast<RegistryEntry*>(m_pool.allocateRaw(
+          sizeof(RegistryEntry), AlignmentOf<RegistryEntry>::value));
+    return m_spare_entry != NULL;
+  }
+
+  /** @brief Хеш-таблица динамического реестра содержит все записи
+   */
+  bool reserve_keyed() { return true; }
+
+  /** @brief метод для поиска записи в хеш-таблице
+   * @param tid Указатель на идентификатор типа
+   * @return Указатель на найденную запись или NULL, если запись не найдена
+   *
+   * @note Используется для типов, чей индекс не помещается в таблицу m_slots
+   * (см. KNOT_MAX_TYPES). Стоимость не зависит от количества сервисов.
+   */
+  RegistryEntry* find_entry_slow(void* tid) {
+    if (m_sealed) return m_sealed_table.find(tid, 0);
+    return find_slot(tid, 0);
+  }
+#else
+  /** @brief метод для получения записи реестра по номеру
+   * @param i Номер записи в порядке регистрации
+   * @return Ссылка на запись
+   */
+  RegistryEntry& entry_at(size_t i) { return m_registry[i]; }
+
+  /** @brief Емкость таблицы временных сервисов
+   */
+  size_t transient_capacity() const { return KNOT_MAX_TRANSIENTS; }
+
+  /** @brief Емкость журнала созданий
+   */
+  size_t creation_capacity() const { return CREATION_LOG_SIZE; }
+
+  /** @brief Журнал созданий фиксирован и не растет
+   * @details Его емкость вдвое больше числа записей, которые могут быть
+   * живы одновременно, поэтому сжатие всегда освобождает место.
+   */
+  bool grow_creations() { return false; }
+
+  /** @brief Таблица временных сервисов фиксирована и не растет
+   */
+  bool grow_transients() { return false; }
+
+  /** @brief метод для проверки, что в реестре есть место под новую запись
+   * @return true, если реестр не заполнен, не запечатан и у контейнера нет
+   * дочерних контейнеров
+   */
+  bool reserve_entry() {
+    return !m_sealed && !LoadAcquire(&m_children) &&
+           m_service_count < KNOT_MAX_SERVICES;
+  }
+
+  /** @brief метод для проверки, что есть место под регистрацию с ключом
+   * @details Хеш-таблица регистраций с ключом очищается при первом вызове,
+   * поэтому контейнер без таких регистраций за нее не платит.
+   * @return true, если таблица не заполнена
+   */
+  bool reserve_keyed() {
+    if (m_keyed_count >= KNOT_MAX_KEYED_SERVICES) return false;
+    if (!m_table) set_table(m_table_storage.data, KEYED_TABLE_SIZE);
+    return true;
+  }
+
+  /** @brief метод для поиска записи в реестре линейным перебором
    * @param tid Указатель на идентификатор типа
    * @return Указатель на найденную запись или nullptr, если запись не найдена
+   *
+   * @note Используется только для типов, чей индекс не помещается в таблицу
+   * m_slots (см. KNOT_MAX_TYPES). После seal() перебор заменяется поиском
+   * в совершенной хеш-таблице.
    */
-  RegistryEntry* find_entry(void* tid) {
+  RegistryEntry* find_entry_slow(void* tid) {
+    if (m_sealed) return m_sealed_table.find(tid, 0);
     for (size_t i = 0; i < m_service_count; ++i)
       if (m_registry[i].type == tid) return &m_registry[i];
     return NULL;
   }
+#endif
+
+  /** @brief метод для поиска записи в собственном реестре по типу сервиса
+   * @tparam T Тип сервиса
+   * @return Указатель на найденную запись или nullptr, если запись не найдена
+   *
+   * @note Для типов с индексом меньше KNOT_MAX_TYPES поиск сводится к одному
+   * чтению из массива и не зависит от количества зарегистрированных сервисов.
+   */
+  template <typename T>
+  RegistryEntry* find_local() {
+    size_t idx = TypeIndex<T>();
+    if (idx < KNOT_MAX_TYPES) return m_slots[idx];
+    return find_entry_slow(TypeId<T>());
+  }
+
+  /** @brief метод для поиска записи по типу сервиса
+   * @details Если тип не зарегистрирован в этом контейнере, поиск
+   * продолжается у родителя.
+   * @tparam T Тип сервиса
+   * @return Указатель на найденную запись или NULL
+   */
+  template <typename T>
+  RegistryEntry* find_entry() {
+    RegistryEntry* entry = find_local<T>();
+    if (entry || !m_parent) return entry;
+    return m_parent->find_entry<T>();
+  }
+
+  /** @brief метод для поиска записи с ключом в собственном реестре
+   * @tparam T Тип сервиса
+   * @param key Ключ регистрации
+   * @return Указатель на найденную запись или NULL
+   */
+  template <typename T>
+  RegistryEntry* find_keyed_local(const ServiceKey& key) const {
+    RegistryEntry* entry = find_keyed_slot<T>(key);
+    if (entry && key.name &&
+        (!entry->name || std::strcmp(entry->name, key.name) != 0))
+      return NULL;
+    return entry;
+  }
+
+  /** @brief метод для поиска записи по хешу ключа
+   * @details В отличие от find_keyed_local() не сравнивает строки: при
+   * регистрации занятым считается и ключ, хеш которого совпал с хешем
+   * другой строки.
+   * @tparam T Тип сервиса
+   * @param key Ключ регистрации
+   * @return Указатель на найденную запись или NULL
+   */
+  template <typename T>
+  RegistryEntry* find_keyed_slot(const ServiceKey& key) const {
+    void* tid = key_type<T>(&key);
+    if (m_sealed) return m_sealed_table.find(tid, key.value);
+    return find_slot(tid, key.value);
+  }
+
+  /** @brief метод для получения идентификатора типа записи
+   * @tparam T Тип сервиса
+   * @param key Ключ регистрации или NULL
+   * @return TypeId<T>, TypeId<Keyed<T> > для целого ключа или
+   * TypeId<Named<T> > для строкового
+   */
+  template <typename T>
+  static void* key_type(const ServiceKey* key) {
+    if (!key) return TypeId<T>();
+    return key->name ? TypeId<Named<T> >() : TypeId<Keyed<T> >();
+  }
+
+  /** @brief метод для копирования строкового ключа в пул
+   * @param key Ключ регистрации
+   * @return Копия строки или NULL для целого ключа и при нехватке памяти
+   */
+  char* copy_name(const ServiceKey& key) {
+    if (!key.name) return NULL;
+    size_t size = std::strlen(key.name) + 1;
+    char* name = static_cast<char*>(m_pool.allocateRaw(size, 1));
+    if (name) std::memcpy(name, key.name, size);
+    return name;
+  }
+
+  /** @brief метод для возврата копии строкового ключа в пул
+   * @param name Копия, полученная из copy_name(), или NULL
+   */
+  void release_name(const char* name) {
+    if (name)
+      m_pool.deallocate(const_cast<char*>(name), std::strlen(name) + 1);
+  }
+
+  /** @brief метод для поиска записи с ключом
+   * @details Как и find_entry(), при промахе обращается к родителю.
+   * @tparam T Тип сервиса
+   * @param key Ключ регистрации
+   * @return Указатель на найденную запись или NULL
+   */
+  template <typename T>
+  RegistryEntry* find_keyed(const ServiceKey& key) const {
+    RegistryEntry* entry = find_keyed_local<T>(key);
+    if (entry || !m_parent) return entry;
+    return m_parent->find_keyed<T>(key);
+  }
+
+  /** @brief метод для поиска контейнера, которому принадлежит запись
+   * @details Номера записей родителей меньше m_index_base, поэтому
+   * владелец находится без поиска по реестрам.
+   * @param entry Запись реестра этого контейнера или его родителей
+   * @return Контейнер, в котором зарегистрирована запись
+   */
+  Container* owner_of(const RegistryEntry* entry) {
+    Container* owner = this;
+    while (entry->index < owner->m_index_base) owner = owner->m_parent;
+    return owner;
+  }
+
+  enum {
+    SEAL_GROUP_SIZE = 4,  // Среднее число записей в группе SealedTable
+    SEAL_ATTEMPTS = 1024  // Число смещений, проверяемых для одной группы
+  };
+
+  /** @brief метод для размещения группы в совершенной хеш-таблице
+   * @details Перебирает смещения, пока все записи группы не попадут в
+   * свободные ячейки. Записи, размещенные при неудачной попытке, снимаются.
+   * @param table Таблица с обнуленными ячейками
+   * @param hashes Хеши записей по номеру в реестре
+   * @param members Номера записей группы
+   * @param count Количество записей группы
+   * @param group Номер группы
+   * @return true, если смещение найдено за SEAL_ATTEMPTS попыток
+   */
+  bool seal_group(SealedTable& table, const size_t* hashes,
+                  const size_t* members, size_t count, size_t group) {
+    for (size_t displacement = 0; displacement < SEAL_ATTEMPTS;
+         ++displacement) {
+      size_t placed = 0;
+      for (; placed < count; ++placed) {
+        size_t i = members[placed];
+        RegistrySlot& slot =
+            table.slots[table.slotOf(hashes[i], displacement)];
+        if (slot.entry) break;
+        slot.type = entry_at(i).type;
+        slot.key = entry_at(i).key;
+        slot.entry = &entry_at(i);
+      }
+      if (placed == count) {
+        table.displacements[group] = displacement;
+        return true;
+      }
+      while (placed > 0) {
+        size_t i = members[--placed];
+        RegistrySlot& slot =
+            table.slots[table.slotOf(hashes[i], displacement)];
+        slot.type = NULL;
+        slot.key = 0;
+        slot.entry = NULL;
+      }
+    }
+    return false;
+  }
+
+  /** @brief метод для заполнения совершенной хеш-таблицы
+   * @details Группы размещаются от больших к меньшим: большой группе
+   * труднее найти смещение, пока таблица еще пуста.
+   * @param table Таблица с обнуленными ячейками
+   * @param hashes Хеши записей по номеру в реестре
+   * @param order Номера записей, упорядоченные по группам
+   * @param starts Начало каждой группы в order; starts[group_count] равен
+   * количеству записей
+   * @return true, если размещены все группы
+   */
+  bool seal_groups(SealedTable& table, const size_t* hashes,
+                   const size_t* order, const size_t* starts) {
+    size_t largest = 0;
+    for (size_t g = 0; g < table.group_count; ++g) {
+      size_t count = starts[g + 1] - starts[g];
+      if (count > largest) largest = count;
+    }
+    for (size_t count = largest; count > 0; --count) {
+      for (size_t g = 0; g < table.group_count; ++g) {
+        if (starts[g + 1] - starts[g] != count) continue;
+        if (!seal_group(table, hashes, order + starts[g], count, g))
+          return false;
+      }
+    }
+    return true;
+  }
+
+  /** @brief метод для добавления новой записи в реестр
+   * @tparam T Тип сервиса
+   * @param key Ключ регистрации или NULL
+   * @return Ссылка на новую запись с заполненным идентификатором типа
+   *
+   * @note Вызывающий код обязан заранее вызвать reserve_entry() (и
+   * reserve_keyed() для записи с ключом) и проверить, что запись еще не
+   * зарегистрирована.
+   */
+  template <typename T>
+  RegistryEntry& add_entry(const ServiceKey* key = NULL) {
+#if KNOT_DYNAMIC_REGISTRY
+    RegistryEntry& entry = *new (m_spare_entry) RegistryEntry();
+    m_spare_entry = NULL;
+    m_registry[m_service_count] = &entry;
+#else
+    RegistryEntry& entry = *new (&m_registry[m_service_count]) RegistryEntry();
+#endif
+    entry.type = key_type<T>(key);
+    entry.key = key ? key->value : 0;
+    entry.name = NULL;
+    entry.index = m_index_base + m_service_count++;
+#if KNOT_DYNAMIC_REGISTRY
+    insert_slot(&entry);
+#else
+    if (key) {
+      insert_slot(&entry);
+      ++m_keyed_count;
+    }
+#endif
+    if (key) return entry;
+    size_t idx = TypeIndex<T>();
+    if (idx < KNOT_MAX_TYPES) m_slots[idx] = &entry;
+    return entry;
+  }
 
   /** @brief метод для регистрации синглтон сервиса
-   * @param factory Указатель на фабрику, создающую сервис
+   * @param factory Фабрика, создающая сервис. Копируется в дескриптор.
+   * @param key Ключ регистрации или NULL
    * @tparam T Тип сервиса
+   * @tparam S Тип создаваемого экземпляра: T или его реализация
+   * @tparam F Тип фабрики
    * @return true, если регистрация успешна, иначе false
    */
-  template <typename T>
-  bool register_singleton(IFactory* factory) {
-    size_t size = sizeof(T);
-    void* mem = m_pool.allocate<Factory<T>>();
+  template <typename T, typename S, typename F>
+  bool register_singleton(const F& factory, const ServiceKey* key = NULL) {
+    void* mem = m_pool.allocate<S>();
     if (!mem) return false;
-    RegistryEntry& entry = m_registry[m_service_count++];
-    entry.type = TypeId<T>();
-    entry.desc.factory = factory;
+    RegistryEntry& entry = add_entry<T>(key);
+    entry.desc.setFactory(factory);
     entry.desc.strategy = SINGLETON;
     entry.desc.instance = NULL;
     entry.desc.storage = mem;
+    entry.desc.storage_size = sizeof(S);
+    entry.desc.storage_align = AlignmentOf<S>::value;
+    entry.desc.bound = TypeId<S>() != TypeId<T>();
+    KNOT_INSTRUMENT(entry.desc.counters.allocated(sizeof(S)));
     return true;
   }
 
   /** @brief метод для регистрации временного сервиса
-   * @param factory Указатель на фабрику, создающую сервис
+   * @param factory Фабрика, создающая сервис. Копируется в дескриптор.
+   * @param strategy Стратегия сервиса (TRANSIENT или SCOPED). Такие сервисы
+   * не получают хранилище при регистрации.
+   * @param key Ключ регистрации или NULL
    * @tparam T Тип сервиса
+   * @tparam S Тип создаваемого экземпляра: T или его реализация
+   * @tparam F Тип фабрики
    * @return true, если регистрация успешна, иначе false
    */
-  template <typename T>
-  bool register_transient(IFactory* factory) {
-    RegistryEntry& entry = m_registry[m_service_count++];
-    entry.type = TypeId<T>();
-    entry.desc.factory = factory;
-    entry.desc.strategy = TRANSIENT;
+  template <typename T, typename S, typename F>
+  bool register_transient(const F& factory, Strategy strategy = TRANSIENT,
+                          const ServiceKey* key = NULL) {
+    RegistryEntry& entry = add_entry<T>(key);
+    entry.desc.setFactory(factory);
+    entry.desc.strategy = strategy;
     entry.desc.instance = NULL;
     entry.desc.storage = NULL;
+    entry.desc.storage_size = sizeof(S) < sizeof(void*) ? sizeof(void*)
+                                                        : sizeof(S);
+    entry.desc.storage_align = AlignmentOf<S>::value;
+    entry.desc.bound = TypeId<S>() != TypeId<T>();
     return true;
   }
 
-  /** @brief метод для выделения фабрики для сервиса
-   * @tparam T Тип сервиса
-   * @return Указатель на созданную фабрику или NULL, если не удалось выделить
-   * память
+  /** @brief метод для получения блока из списка повторного использования
+   * @param desc Дескриптор временного сервиса
+   * @return Блок размером desc.storage_size или NULL, если список пуст
    */
-  template <typename T>
-  inline IFactory* alloc_factory() {
-    void* mem = m_pool.allocate<Factory<T>>();
-    if (!mem) return NULL;
-    IFactory* factory = new (mem) Factory<T>();
-    if (m_factory_count >= KNOT_MAX_SERVICES) return NULL;
-    m_factories[m_factory_count++] = factory;
-    return factory;
+  void* pop_recycled(Descriptor& desc) {
+    void* block = desc.recycle_head;
+    if (!block) return NULL;
+    std::memcpy(&desc.recycle_head, block, sizeof(void*));
+    --desc.recycle_count;
+    return block;
+  }
+
+  /** @brief метод для возврата блока в список повторного использования
+   * @details Указатель на следующий блок хранится в самом блоке, поэтому
+   * размер блока временного сервиса не меньше размера указателя.
+   * @param desc Дескриптор временного сервиса
+   * @param block Блок размером desc.storage_size
+   * @return true, если блок помещен в список; false, если список заполнен
+   */
+  bool push_recycled(Descriptor& desc, void* block) {
+    if (desc.recycle_count >= desc.recycle_limit) return false;
+    std::memcpy(block, &desc.recycle_head, sizeof(void*));
+    desc.recycle_head = block;
+    ++desc.recycle_count;
+    return true;
+  }
+
+  /** @brief метод для сокращения списка повторного использования
+   * @param desc Дескриптор временного сервиса
+   * @param keep Количество блоков, которое нужно оставить в списке
+   */
+  void trim_recycled(Descriptor& desc, size_t keep) {
+    while (desc.recycle_count > keep)
+      m_pool.deallocate(pop_recycled(desc), desc.storage_size);
   }
 
   /** @brief метод для удаления временного сервиса по индексу
    * @param idx Индекс временного сервиса в массиве m_transients
    * @note Этот метод освобождает память, занятую временным сервисом, и вызывает
-   * его деструктор.
+   * его деструктор. Для пакета экземпляров деструкторы вызываются для всех
+   * экземпляров пакета. Поколение записи увеличивается, поэтому все выданные
+   * на нее дескрипторы становятся недействительными.
    */
   inline void destroyTransientAt(size_t idx) {
-    if (m_transients[idx].ptr && m_transients[idx].factory)
-      m_transients[idx].factory->destroy(m_transients[idx].ptr);
-    if (m_transients[idx].ptr)
-      m_pool.deallocate(m_transients[idx].ptr, m_transients[idx].alloc_size);
-    m_transients[idx].ptr = NULL;
-    m_transients[idx].alloc_size = 0;
-    m_transients[idx].factory = NULL;
+    TransientInfo& info = m_transients[idx];
+    if (info.ptr && info.desc) {
+      size_t stride = info.alloc_size / info.count;
+      unsigned char* item = static_cast<unsigned char*>(info.ptr);
+      for (size_t i = 0; i < info.count; ++i, item += stride)
+        info.desc->destroy(item);
+    }
+    // Память экземпляров запроса освобождает сброс арены в endRequest()
+    if (info.ptr && !info.in_request &&
+        !(info.recycle && push_recycled(*info.desc, info.ptr)))
+      m_pool.deallocate(info.ptr, info.alloc_size);
+    info.ptr = NULL;
+    info.instance = NULL;
+    info.alloc_size = 0;
+    info.count = 0;
+    info.desc = NULL;
+    info.recycle = false;
+    info.in_request = false;
+    ++info.generation;
+  }
+
+  /** @brief метод для удаления временного сервиса с возвратом записи в стек
+   * @param idx Индекс живого временного сервиса в массиве m_transients
+   */
+  inline void releaseTransientAt(size_t idx) {
+    destroyTransientAt(idx);
+    m_free_transients[m_free_transient_count++] = idx;
+    --m_transient_count;
+  }
+
+  /** @brief метод для сжатия журнала созданий
+   * @details Сохраняет порядок оставшихся записей. Записи уничтоженных
+   * временных сервисов отбрасываются всегда: их дескрипторы устарели.
+   * @param keep_singletons Оставить записи синглтонов
+   * @param keep_transients Оставить записи живых временных сервисов
+   */
+  void compact_creations(bool keep_singletons, bool keep_transients) {
+    size_t kept = 0;
+    for (size_t i = 0; i < m_creation_count; ++i) {
+      const CreationRecord& record = m_creation_log[i];
+      bool keep = record.singleton
+                      ? keep_singletons
+                      : keep_transients && find_transient(record.transient);
+      if (keep) m_creation_log[kept++] = record;
+    }
+    m_creation_count = kept;
+  }
+
+  /** @brief метод для резервирования записи журнала созданий
+   * @details Вызывается под блокировкой m_mutex до вызова фабрики, чтобы
+   * созданный экземпляр всегда попал в журнал. Заполненный журнал сначала
+   * сжимается; если после сжатия он занят больше чем наполовину, он растет.
+   * Зарезервированная запись занимается log_creation() или возвращается
+   * cancel_creation().
+   * @return true, если место для записи есть
+   */
+  bool reserve_creation() {
+    if (m_creation_count + m_creation_pending >= creation_capacity()) {
+      compact_creations(true, true);
+      size_t used = m_creation_count + m_creation_pending;
+      if (2 * used >= creation_capacity() && !grow_creations() &&
+          used >= creation_capacity())
+        return false;
+    }
+    ++m_creation_pending;
+    return true;
+  }
+
+  /** @brief метод для возврата зарезервированной записи журнала
+   * @details Вызывается под блокировкой m_mutex, если экземпляр не создан.
+   */
+  void cancel_creation() { --m_creation_pending; }
+
+  /** @brief метод для записи созданного экземпляра в журнал
+   * @details Вызывается под блокировкой m_mutex после завершения фабрики и
+   * занимает запись, зарезервированную reserve_creation().
+   * @param singleton Дескриптор синглтона или NULL
+   * @param transient Дескриптор временного сервиса, если singleton равен NULL
+   */
+  void log_creation(Descriptor* singleton, TransientHandle transient) {
+    --m_creation_pending;
+    CreationRecord& record = m_creation_log[m_creation_count++];
+    record.singleton = singleton;
+    record.transient = transient;
+  }
+
+  /** @brief метод для уничтожения синглтона
+   * @details Хранилище возвращается в пул и будет выделено повторно при
+   * следующем вызове resolve.
+   * @param desc Дескриптор созданного синглтона
+   */
+  void destroy_singleton(Descriptor& desc) {
+    if (desc.instance) {
+      desc.destroy(desc.storage);
+      StoreRelease(&desc.instance, static_cast<void*>(NULL));
+    }
+    StoreRelease(&desc.state, Descriptor::EMPTY);
+    if (desc.storage) {
+      m_pool.deallocate(desc.storage, desc.storage_size);
+      desc.storage = NULL;
+    }
+  }
+
+  /** @brief метод для уничтожения экземпляров по журналу созданий
+   * @details Журнал обходится с конца, поэтому зависимые экземпляры
+   * уничтожаются раньше своих зависимостей. Стоимость пропорциональна
+   * числу записей журнала, а не числу регистраций. Вызывается под
+   * блокировкой m_mutex: журнал и пул разделяются с create_transient().
+   * @param singletons Уничтожить синглтоны
+   * @param transients Уничтожить временные сервисы
+   */
+  void destroy_created(bool singletons, bool transients) {
+    for (size_t i = m_creation_count; i-- > 0;) {
+      const CreationRecord& record = m_creation_log[i];
+      if (record.singleton) {
+        if (singletons) destroy_singleton(*record.singleton);
+      } else if (transients && find_transient(record.transient)) {
+        destroyTransientAt(record.transient.index);
+      }
+    }
+    compact_creations(!singletons, !transients);
   }
 
+  /** @brief метод для выделения памяти экземпляра из арены запроса
+   * @details Вызывается под блокировкой m_mutex. Запись журнала и экземпляр
+   * выделяются одним блоком: запись в начале, экземпляр после нее с нужным
+   * выравниванием. create_transient связывает запись с журналом, когда
+   * экземпляр получит запись m_transients.
+   * @param size Размер экземпляра в байтах
+   * @param align Выравнивание экземпляра
+   * @param record Указатель для записи журнала
+   * @return Память экземпляра или NULL, если арена заполнена
+   */
+  void* allocate_request(size_t size, size_t align, RequestRecord** record) {
+    size_t header = (sizeof(RequestRecord) + align - 1) / align * align;
+    size_t record_align = AlignmentOf<RequestRecord>::value;
+    uint8_t* block = static_cast<uint8_t*>(m_request_arena.allocateRaw(
+        header + size, align > record_align ? align : record_align));
+    if (!block) return NULL;
+    *record = reinterpret_cast<RequestRecord*>(block);
+    return block + header;
+  }
+
+  /** @brief метод для создания временного сервиса
+   * @details Экземпляры пакета размещаются подряд в одном блоке памяти пула и
+   * учитываются одной записью m_transients. Экземпляр по записи родителя
+   * создается в пуле этого контейнера и не использует список повторного
+   * использования родителя. Между beginRequest() и endRequest() память
+   * берется из арены запроса.
+   * @param entry Запись временного сервиса
+   * @param handle Дескриптор созданной записи или NULL
+   * @param count Количество экземпляров в пакете
+   * @tparam T Тип сервиса
+   * @return Указатель на первый созданный экземпляр или NULL
+   *
+   * @note Пакет (count > 1) создается только для сервисов без привязки к
+   * интерфейсу, поэтому экземпляры пакета имеют тип T и лежат с шагом
+   * sizeof(T).
+   */
+  template <typename T>
+  T* create_transient(RegistryEntry& entry, TransientHandle* handle,
+                      size_t count = 1) {
+    Descriptor& desc = entry.desc;
+    ResolveGuard resolving(desc);
+    if (!resolving.entered()) return NULL;
+    void* mem = NULL;
+    size_t idx = 0;
+    {
+      LockGuard guard(m_mutex);
+      if (!m_free_transient_count && m_transient_high >= transient_capacity() &&
+          !grow_transients())
+        return NULL;
+      if (!reserve_creation()) return NULL;
+      size_t size = count == 1 ? desc.storage_size : sizeof(T) * count;
+      bool recycle =
+          count == 1 && entry.index >= m_index_base && !m_in_request;
+      RequestRecord* record = NULL;
+      mem = recycle ? pop_recycled(desc) : NULL;
+      if (mem) {
+        ++desc.recycle_hits;
+      } else {
+        mem = m_in_request ? allocate_request(size, desc.storage_align, &record)
+                           : m_pool.allocateRaw(size, desc.storage_align);
+        if (!mem) {
+          cancel_creation();
+          return NULL;
+        }
+        KNOT_INSTRUMENT(desc.counters.allocated(size));
+        if (recycle) ++desc.recycle_misses;
+      }
+      idx = m_free_transient_count ? m_free_transients[--m_free_transient_count]
+                                   : m_transient_high++;
+      TransientInfo& info = m_transients[idx];
+      info.ptr = NULL;
+      info.instance = NULL;
+      info.desc = &desc;
+      info.alloc_size = size;
+      info.count = count;
+      info.recycle = recycle;
+      info.in_request = record != NULL;
+      if (!info.generation) info.generation = 1;
+      ++m_transient_count;
+      if (handle) {
+        handle->index = static_cast<uint32_t>(idx);
+        handle->generation = info.generation;
+      }
+      if (record) {
+        record->prev = m_request_log;
+        record->handle.index = static_cast<uint32_t>(idx);
+        record->handle.generation = info.generation;
+        m_request_log = record;
+      }
+    }
+    // Фабрика вызывается без блокировки: она может разрешать зависимости,
+    // в том числе синглтоны, которые создаются другими потоками.
+    T* ptr = static_cast<T*>(mem);
+    KNOT_INSTRUMENT(size_t started = MonotonicNanos());
+    void* instance = desc.create(ptr);
+    for (size_t i = 1; i < count; ++i) desc.create(ptr + i);
+    KNOT_INSTRUMENT(desc.counters.constructed(count, started));
+    LockGuard guard(m_mutex);
+    TransientInfo& info = m_transients[idx];
+    info.ptr = mem;
+    if (resolving.dependencyFailed()) {
+      // Экземпляр получил NULL вместо зависимости из цикла: он уничтожается,
+      // и разрешение отказывает целиком.
+      releaseTransientAt(idx);
+      cancel_creation();
+      if (handle) *handle = TransientHandle();
+      return NULL;
+    }
+    info.instance = instance;
+    TransientHandle created;
+    created.index = static_cast<uint32_t>(idx);
+    created.generation = info.generation;
+    log_creation(NULL, created);
+    return static_cast<T*>(instance);
+  }
+
+  /** @brief метод для создания синглтона
+   * @details Медленный путь resolve. Создание выполняет ровно один поток:
+   * он переводит состояние дескриптора из EMPTY в BUILDING, создает
+   * экземпляр и публикует его с семантикой release. Остальные потоки ждут
+   * публикации. Повторный вход того же потока (циклическая зависимость)
+   * возвращает NULL. Цикл, разделенный между потоками (поток 1 создает A и
+   * ждет B, поток 2 создает B и ждет A), обнаруживается по цепочке
+   * ожиданий, и ожидающий поток тоже получает NULL. Экземпляр, которому
+   * цикл не дал зависимость, уничтожается, и создание отказывает.
+   * @param desc Дескриптор синглтона
+   * @return Указатель на экземпляр или NULL
+   */
+  void* construct_singleton(Descriptor& desc) {
+    ResolveGuard resolving(desc);
+    if (!resolving.entered()) return NULL;
+    size_t self = CurrentThreadId();
+    bool waiting = false;
+    while (!CompareExchange(&desc.state, Descriptor::EMPTY,
+                            Descriptor::BUILDING)) {
+      void* instance = LoadAcquire(&desc.instance);
+      if (!instance && !waiting) {
+        mark_waiting(self, &desc);
+        waiting = true;
+      }
+      if (instance || waits_for(desc, self)) {
+        if (waiting) mark_waiting(self, NULL);
+        if (!instance) ResolveGuard::reportCycle();
+        return instance;
+      }
+      Yield();
+    }
+    if (waiting) mark_waiting(self, NULL);
+    StoreRelease(&desc.owner, self);
+    bool reserved = false;
+    {
+      LockGuard guard(m_mutex);
+      reserved = reserve_creation();
+      if (reserved && !desc.storage) {
+        desc.storage =
+            m_pool.allocateRaw(desc.storage_size, desc.storage_align);
+        KNOT_INSTRUMENT(if (desc.storage)
+                            desc.counters.allocated(desc.storage_size));
+      }
+    }
+    KNOT_INSTRUMENT(size_t started = MonotonicNanos());
+    void* instance =
+        reserved && desc.storage ? desc.create(desc.storage) : NULL;
+    KNOT_INSTRUMENT(if (instance) desc.counters.constructed(1, started));
+    if (instance && resolving.dependencyFailed()) {
+      desc.destroy(desc.storage);
+      instance = NULL;
+    }
+    if (reserved) {
+      LockGuard guard(m_mutex);
+      if (instance)
+        log_creation(&desc, TransientHandle());
+      else
+        cancel_creation();
+    }
+    StoreRelease(&desc.instance, instance);
+    StoreRelease(&desc.owner, 0);
+    StoreRelease(&desc.state,
+                 instance ? Descriptor::READY : Descriptor::EMPTY);
+    return instance;
+  }
+
+  /** @brief метод для отметки ожидания синглтона текущим потоком
+   * @details Записывает ожидаемый дескриптор в синглтоны, которые создает
+   * текущий поток, чтобы другие потоки могли пройти по цепочке ожиданий.
+   * @param self Идентификатор текущего потока
+   * @param target Ожидаемый дескриптор или NULL по окончании ожидания
+   */
+  static void mark_waiting(size_t self, Descriptor* target) {
+    ResolveStack& stack = CurrentResolveStack();
+    for (size_t i = 0; i < stack.depth; ++i) {
+      Descriptor* held = const_cast<Descriptor*>(stack.entries[i]);
+      if (LoadAcquire(&held->owner) == self)
+        StoreRelease(&held->waiting, static_cast<void*>(target));
+    }
+  }
+
+  /** @brief метод для поиска цикла ожиданий
+   * @details Переходит от ожидаемого синглтона к потоку, который его
+   * создает, и к синглтону, которого ждет этот поток. Если цепочка
+   * приходит к текущему потоку, ожидание никогда не закончится.
+   * @param desc Ожидаемый дескриптор
+   * @param self Идентификатор текущего потока
+   * @return true, если текущий поток ждет сам себя
+   */
+  static bool waits_for(const Descriptor& desc, size_t self) {
+    const Descriptor* next = &desc;
+    for (size_t hops = 0; next && hops < KNOT_MAX_RESOLVE_DEPTH; ++hops) {
+      if (LoadAcquire(&next->owner) == self) return true;
+      next = static_cast<const Descriptor*>(LoadAcquire(&next->waiting));
+    }
+    return false;
+  }
+
+  /** @brief Набор синглтонов одного уровня для warmUp
+   */
+  struct WarmUpTask {
+    Container* container;   // Контейнер, которому принадлежат синглтоны
+    RegistryEntry** batch;  // Записи синглтонов уровня
+    size_t count;           // Количество записей
+    size_t next;            // Номер следующей записи для создания
+    size_t built;           // Количество созданных синглтонов
+  };
+
+  /** @brief метод потока warmUp
+   * @details Забирает записи из общего набора атомарным счетчиком, пока они
+   * не закончатся.
+   * @param arg Указатель на WarmUpTask
+   */
+  static void warm_up_worker(void* arg) {
+    WarmUpTask* task = static_cast<WarmUpTask*>(arg);
+    for (;;) {
+      size_t i = FetchAdd(&task->next, 1);
+      if (i >= task->count) break;
+      if (task->container->construct_singleton(task->batch[i]->desc))
+        FetchAdd(&task->built, 1);
+    }
+  }
+
+  /** @brief метод для вычисления уровня записи в графе зависимостей
+   * @details Уровень записи без зависимостей равен нулю, иначе он на единицу
+   * больше максимального уровня зависимостей. Записи одного уровня не зависят
+   * друг от друга ни напрямую, ни через другие сервисы. Ребро, замыкающее
+   * цикл, не учитывается.
+   * @param i Номер записи в реестре
+   * @param levels Вычисленные уровни записей
+   * @param marks Состояние обхода: 0 - не посещена, 1 - в обходе, 2 - готова
+   * @return Уровень записи
+   */
+  size_t dependency_level(size_t i, size_t* levels, unsigned char* marks) {
+    if (marks[i] == 2) return levels[i];
+    if (marks[i] == 1) return 0;
+    marks[i] = 1;
+    size_t level = 0;
+    void* ids[IFactory::MAX_DEPENDENCIES];
+    size_t count = entry_at(i).desc.dependencies(ids);
+    for (size_t k = 0; k < count; ++k) {
+      RegistryEntry* dep = find_entry_slow(ids[k]);
+      if (!dep) continue;
+      size_t dep_index = dep->index - m_index_base;
+      if (marks[dep_index] == 1) continue;
+      size_t dep_level = dependency_level(dep_index, levels, marks) + 1;
+      if (dep_level > level) level = dep_level;
+    }
+    marks[i] = 2;
+    levels[i] = level;
+    return level;
+  }
+
+  /** @brief метод для выделения области памяти из пула контейнера
+   * @param size Размер области в байтах
+   * @return Указатель на область или NULL
+   */
+  void* allocate_region(size_t size) {
+    LockGuard guard(m_mutex);
+    return m_pool.allocateRaw(size, AlignmentOf<MaxAlign>::value);
+  }
+
+  /** @brief метод для возврата области памяти в пул контейнера
+   * @param ptr Указатель на область
+   * @param size Размер области в байтах
+   */
+  void release_region(void* ptr, size_t size) {
+    LockGuard guard(m_mutex);
+    m_pool.deallocate(ptr, size);
+  }
+
+  /** @brief метод для поиска живой записи временного сервиса по дескриптору
+   * @param handle Дескриптор временного сервиса
+   * @return Указатель на запись или NULL, если дескриптор устарел
+   */
+  TransientInfo* find_transient(TransientHandle handle) {
+    if (handle.index >= m_transient_high) return NULL;
+    TransientInfo& info = m_transients[handle.index];
+    if (!info.ptr || info.generation != handle.generation) return NULL;
+    return &info;
+  }
+
+#if KNOT_INSTRUMENTATION
+  /** @brief метод для снимка счетчиков записи реестра
+   * @param entry Запись реестра или NULL
+   * @return Снимок; для NULL все значения равны нулю
+   */
+  static ServiceStats stats_of(const RegistryEntry* entry) {
+    ServiceStats stats;
+    std::memset(&stats, 0, sizeof(stats));
+    if (!entry) return stats;
+    stats.type = entry->type;
+    stats.key = entry->key;
+    stats.name = entry->name;
+    stats.index = entry->index;
+    stats.strategy = entry->desc.strategy;
+    stats.counters = entry->desc.counters.snapshot();
+    return stats;
+  }
+#endif
+
   /** @brief метод для добавления сервиса в контейнер
-   * @param strategy Стратегия создания сервиса (SINGLETON или TRANSIENT). По
-   * умолчанию SINGLETON.
-   * @param factory Указатель на фабрику, создающую сервис
+   * @param strategy Стратегия создания сервиса (SINGLETON, TRANSIENT или
+   * SCOPED). По умолчанию SINGLETON.
+   * @param factory Фабрика, создающая сервис. Копируется в дескриптор.
+   * @tparam T Тип сервиса
+   * @tparam F Тип фабрики
+   *
+   * @note Inline функция, которая применяетс строго внутри макроса генерации
+   * сервисов различной арности.
+   */
+  template <typename T, typename F>
+  inline bool addService(Strategy strategy, const F& factory) {
+    if (find_local<T>() || !reserve_entry()) return false;
+    return register_entry<T, T>(strategy, factory, NULL);
+  }
+
+  /** @brief метод для добавления реализации под интерфейсом
+   * @details Запись реестра создается для I, а хранилище выделяется под C.
+   * Фабрика F оборачивается в BoundFactory, которая возвращает уже
+   * приведенный к I указатель.
+   * @param strategy Стратегия создания сервиса
+   * @param factory Фабрика, создающая реализацию
+   * @tparam I Интерфейс сервиса
+   * @tparam C Реализация интерфейса
+   * @tparam F Тип фабрики
+   */
+  template <typename I, typename C, typename F>
+  inline bool addBinding(Strategy strategy, const F& factory) {
+    if (find_local<I>() || !reserve_entry()) return false;
+    return register_entry<I, C>(strategy, BoundFactory<I, C, F>(factory),
+                                NULL);
+  }
+
+  /** @brief метод для добавления сервиса с ключом в контейнер
+   * @param key Ключ регистрации
+   * @param strategy Стратегия создания сервиса
+   * @param factory Фабрика, создающая сервис. Копируется в дескриптор.
+   * @tparam T Тип сервиса
+   * @tparam F Тип фабрики
+   */
+  template <typename T, typename F>
+  inline bool addService(const ServiceKey& key, Strategy strategy,
+                         const F& factory) {
+    if (find_keyed_slot<T>(key) || !reserve_entry() || !reserve_keyed())
+      return false;
+    char* name = copy_name(key);
+    if (key.name && !name) return false;
+    if (!register_entry<T, T>(strategy, factory, &key)) {
+      release_name(name);
+      return false;
+    }
+    entry_at(m_service_count - 1).name = name;
+    return true;
+  }
+
+  /** @brief метод для создания записи реестра по стратегии
+   * @param strategy Стратегия создания сервиса
+   * @param factory Фабрика, создающая сервис
+   * @param key Ключ регистрации или NULL
    * @tparam T Тип сервиса
-   *
-   * @note Inline функция, которая применяетс строго внутри макроса генерации
-   * сервисов различной арности.
+   * @tparam S Тип создаваемого экземпляра: T или его реализация
+   * @tparam F Тип фабрики
+   * @return true, если регистрация успешна, иначе false
    */
-  template <typename T>
-  inline bool addService(Strategy strategy, IFactory* factory) {
-    void* tid = TypeId<T>();
-    if (!factory || m_service_count >= KNOT_MAX_SERVICES || find_entry(tid))
-      return false;
+  template <typename T, typename S, typename F>
+  bool register_entry(Strategy strategy, const F& factory,
+                      const ServiceKey* key) {
     switch (strategy) {
       case SINGLETON:
-        return register_singleton<T>(factory);
+        return register_singleton<T, S>(factory, key);
         break;
       case TRANSIENT:
-        return register_transient<T>(factory);
+        return register_transient<T, S>(factory, TRANSIENT, key);
+        break;
+      case SCOPED:
+        return register_transient<T, S>(factory, SCOPED, key);
         break;
       default:
         return false;
     }
   }
 
-  /** @brief Уничтожение всех зарегистрированных фабрик
-   * @details Этот метод освобождает память, занятую всеми зарегистрированными
-   * фабриками, и вызывает их деструкторы.
-   *
-   * @note Этот метод вызывается в деструкторе контейнера для освобождения
-   * ресурсов.
-   */
-  inline void destroyAllFactories() {
-    for (size_t i = 0; i < m_factory_count; ++i) {
-      if (m_factories[i]) {
-        m_factories[i]->destroy(m_factories[i]);
-        m_pool.deallocate(m_factories[i], sizeof(IFactory*));
-        m_factories[i] = NULL;
+  /** @brief метод для разрешения сервиса по найденной записи
+   * @tparam T Тип сервиса
+   * @param entry Запись реестра или NULL
+   * @return Указатель на сервис или NULL
+   */
+  template <typename T>
+  T* resolve_entry(RegistryEntry* entry) {
+    if (!entry) return NULL;
+    Descriptor& desc = entry->desc;
+    KNOT_INSTRUMENT(desc.counters.resolved());
+    switch (desc.strategy) {
+      case SINGLETON: {
+        void* instance = LoadAcquire(&desc.instance);
+        if (!instance) instance = owner_of(entry)->construct_singleton(desc);
+        KNOT_INSTRUMENT(if (!instance) desc.counters.failed());
+        return static_cast<T*>(instance);
       }
+      case TRANSIENT: {
+        T* instance = create_transient<T>(*entry, NULL);
+        KNOT_INSTRUMENT(if (!instance) desc.counters.failed());
+        return instance;
+      }
+      case EXTERNAL: {
+        if (!desc.instance) return NULL;
+        return static_cast<T*>(desc.instance);
+      }
+      case SCOPED: {
+        ActiveScope& active = CurrentScope();
+        if (!active.scope || building_singleton()) return NULL;
+        return static_cast<T*>(active.resolve(active.scope, entry));
+      }
+      default:
+        return NULL;
     }
-    m_factory_count = 0;
+  }
+
+  /** @brief Создается ли в текущем потоке синглтон
+   * @details Синглтон переживает область видимости, поэтому SCOPED
+   * зависимость ему не внедряется, даже если область активна.
+   * @return true, если в стеке создаваемых сервисов есть синглтон
+   */
+  static bool building_singleton() {
+    const ResolveStack& stack = CurrentResolveStack();
+    for (size_t i = 0; i < stack.depth; ++i)
+      if (stack.entries[i]->strategy == SINGLETON) return true;
+    return false;
   }
 
  public:
@@ -185,10 +1371,40 @@ class Container {
    * все выделения будут происходить в динамической памяти.
    */
   Container()
-      : m_transient_count(0),
-        m_factory_count(0),
-        m_service_count(0),
-        m_pool(4096) {}
+      : m_service_count(0),
+        m_transient_count(0),
+        m_transient_high(0),
+        m_free_transient_count(0),
+        m_pool(4096),
+        m_table(NULL),
+        m_table_size(0),
+        m_table_shift(0),
+        m_sealed(false),
+        m_sealed_table(),
+        m_parent(NULL),
+        m_index_base(0),
+        m_children(0),
+        m_request_region(NULL),
+        m_request_region_size(0),
+        m_request_arena(static_cast<void*>(NULL), 0),
+        m_request_log(NULL),
+        m_in_request(false),
+        m_creation_count(0),
+        m_creation_pending(0),
+#if KNOT_DYNAMIC_REGISTRY
+        m_registry(NULL),
+        m_registry_capacity(0),
+        m_spare_entry(NULL),
+        m_transients(NULL),
+        m_free_transients(NULL),
+        m_transient_capacity(0),
+        m_creation_log(NULL),
+        m_creation_capacity(0),
+#else
+        m_registry(reinterpret_cast<RegistryEntry*>(m_registry_storage.data)),
+        m_keyed_count(0),
+#endif
+        m_slots() {}
 
   /** @brief Конструктор контейнера с указанием максимального размера пула
    * памяти
@@ -203,10 +1419,40 @@ class Container {
    * все выделения будут происходить в динамической памяти.
    */
   Container(size_t max_bytes)
-      : m_transient_count(0),
-        m_factory_count(0),
-        m_service_count(0),
-        m_pool(max_bytes) {}
+      : m_service_count(0),
+        m_transient_count(0),
+        m_transient_high(0),
+        m_free_transient_count(0),
+        m_pool(max_bytes),
+        m_table(NULL),
+        m_table_size(0),
+        m_table_shift(0),
+        m_sealed(false),
+        m_sealed_table(),
+        m_parent(NULL),
+        m_index_base(0),
+        m_children(0),
+        m_request_region(NULL),
+        m_request_region_size(0),
+        m_request_arena(static_cast<void*>(NULL), 0),
+        m_request_log(NULL),
+        m_in_request(false),
+        m_creation_count(0),
+        m_creation_pending(0),
+#if KNOT_DYNAMIC_REGISTRY
+        m_registry(NULL),
+        m_registry_capacity(0),
+        m_spare_entry(NULL),
+        m_transients(NULL),
+        m_free_transients(NULL),
+        m_transient_capacity(0),
+        m_creation_log(NULL),
+        m_creation_capacity(0),
+#else
+        m_registry(reinterpret_cast<RegistryEntry*>(m_registry_storage.data)),
+        m_keyed_count(0),
+#endif
+        m_slots() {}
 
   /** @brief Конструктор контейнера с указанием буфера и его размера
    * @details Создает контейнер с нулевым счетчиком сервисов и временных
@@ -222,10 +1468,40 @@ class Container {
    */
   template <size_t N>
   Container(uint8_t (&buffer)[N])
-      : m_transient_count(0),
-        m_factory_count(0),
-        m_service_count(0),
-        m_pool(buffer) {}
+      : m_service_count(0),
+        m_transient_count(0),
+        m_transient_high(0),
+        m_free_transient_count(0),
+        m_pool(buffer),
+        m_table(NULL),
+        m_table_size(0),
+        m_table_shift(0),
+        m_sealed(false),
+        m_sealed_table(),
+        m_parent(NULL),
+        m_index_base(0),
+        m_children(0),
+        m_request_region(NULL),
+        m_request_region_size(0),
+        m_request_arena(static_cast<void*>(NULL), 0),
+        m_request_log(NULL),
+        m_in_request(false),
+        m_creation_count(0),
+        m_creation_pending(0),
+#if KNOT_DYNAMIC_REGISTRY
+        m_registry(NULL),
+        m_registry_capacity(0),
+        m_spare_entry(NULL),
+        m_transients(NULL),
+        m_free_transients(NULL),
+        m_transient_capacity(0),
+        m_creation_log(NULL),
+        m_creation_capacity(0),
+#else
+        m_registry(reinterpret_cast<RegistryEntry*>(m_registry_storage.data)),
+        m_keyed_count(0),
+#endif
+        m_slots() {}
 
   /** @brief Конструктор контейнера с указанием буфера и его размера, а также
    * его типа. Применяется для инициализации контейнера с фиксированным буфером
@@ -244,20 +1520,149 @@ class Container {
    */
   template <typename T, size_t N>
   Container(T (&buffer)[N])
-      : m_transient_count(0),
-        m_factory_count(0),
-        m_service_count(0),
-        m_pool(buffer) {}
+      : m_service_count(0),
+        m_transient_count(0),
+        m_transient_high(0),
+        m_free_transient_count(0),
+        m_pool(buffer),
+        m_table(NULL),
+        m_table_size(0),
+        m_table_shift(0),
+        m_sealed(false),
+        m_sealed_table(),
+        m_parent(NULL),
+        m_index_base(0),
+        m_children(0),
+        m_request_region(NULL),
+        m_request_region_size(0),
+        m_request_arena(static_cast<void*>(NULL), 0),
+        m_request_log(NULL),
+        m_in_request(false),
+        m_creation_count(0),
+        m_creation_pending(0),
+#if KNOT_DYNAMIC_REGISTRY
+        m_registry(NULL),
+        m_registry_capacity(0),
+        m_spare_entry(NULL),
+        m_transients(NULL),
+        m_free_transients(NULL),
+        m_transient_capacity(0),
+        m_creation_log(NULL),
+        m_creation_capacity(0),
+#else
+        m_registry(reinterpret_cast<RegistryEntry*>(m_registry_storage.data)),
+        m_keyed_count(0),
+#endif
+        m_slots() {}
+
+  /** @brief Конструктор дочернего контейнера
+   * @details Дочерний контейнер не копирует реестр родителя: он хранит
+   * указатель на родителя и собственный пустой реестр. Регистрации
+   * дочернего контейнера переопределяют регистрации родителя, а типы и
+   * ключи, которых в нем нет, ищутся у родителя. Синглтоны родителя
+   * создаются и хранятся родителем и общие для всех дочерних контейнеров.
+   * TRANSIENT экземпляры, созданные через дочерний контейнер, размещаются
+   * в его пуле и уничтожаются вместе с ним:
+   * @code
+   * Knot::Container request(Knot::CHILD_OF, app);
+   * request.registerInstance<User>(&user);
+   * Handler* h = request.resolve<Handler>();
+   * @endcode
+   * Пока у контейнера есть дочерние, регистрация в нем запрещена, поэтому
+   * номера записей родителя и дочернего контейнера не пересекаются.
+   * Зависимости, внедренные через inject() и lazy(), разрешаются
+   * контейнером, у которого зарегистрирован зависимый сервис.
+   * @note Дочерний контейнер - полноценный объект Container. В режиме
+   * фиксированного реестра его массивы имеют размеры KNOT_MAX_SERVICES,
+   * KNOT_MAX_TRANSIENTS и KNOT_MAX_TYPES, как у любого контейнера; при
+   * KNOT_DYNAMIC_REGISTRY=1 реестр, таблица временных сервисов и журнал
+   * созданий выделяются из пула дочернего контейнера по мере надобности.
+   * Пул дочернего контейнера пуст до первого выделения и растет блоками от
+   * KNOT_CHILD_POOL_CHUNK_BYTES байт, так что max_bytes - предел, а не
+   * начальный размер.
+   * @param parent Родительский контейнер
+   * @param max_bytes Максимальный размер пула дочернего контейнера в байтах
+   *
+   * @warning Дочерний контейнер должен быть уничтожен раньше родителя.
+   */
+  Container(ChildOf, Container& parent, size_t max_bytes = 4096)
+      : m_service_count(0),
+        m_transient_count(0),
+        m_transient_high(0),
+        m_free_transient_count(0),
+        m_pool(max_bytes, KNOT_CHILD_POOL_CHUNK_BYTES),
+        m_table(NULL),
+        m_table_size(0),
+        m_table_shift(0),
+        m_sealed(false),
+        m_sealed_table(),
+        m_parent(&parent),
+        m_index_base(parent.m_index_base + parent.m_service_count),
+        m_children(0),
+        m_request_region(NULL),
+        m_request_region_size(0),
+        m_request_arena(static_cast<void*>(NULL), 0),
+        m_request_log(NULL),
+        m_in_request(false),
+        m_creation_count(0),
+        m_creation_pending(0),
+#if KNOT_DYNAMIC_REGISTRY
+        m_registry(NULL),
+        m_registry_capacity(0),
+        m_spare_entry(NULL),
+        m_transients(NULL),
+        m_free_transients(NULL),
+        m_transient_capacity(0),
+        m_creation_log(NULL),
+        m_creation_capacity(0),
+#else
+        m_registry(reinterpret_cast<RegistryEntry*>(m_registry_storage.data)),
+        m_keyed_count(0),
+#endif
+        m_slots() {
+    FetchAdd(&parent.m_children, 1);
+  }
 
   /** @brief Деструктор контейнера
-   * @details Освобождает все зарегистрированные сервисы и временные сервисы,
-   * вызывая соответствующие методы для уничтожения синглтонов и временных
-   * сервисов.
+   * @details Уничтожает созданные синглтоны и временные сервисы в порядке,
+   * обратном порядку создания, освобождает хранилища несозданных
+   * синглтонов, после чего уничтожает фабрики, хранящиеся в дескрипторах
+   * реестра.
    */
   ~Container() {
-    destroyAllSingletons();
-    destroyAllTransients();
-    destroyAllFactories();
+    {
+      LockGuard guard(m_mutex);
+      destroy_created(true, true);
+    }
+    if (m_request_region)
+      m_pool.deallocate(m_request_region, m_request_region_size);
+    for (size_t i = 0; i < m_service_count; ++i) {
+      Descriptor& desc = entry_at(i).desc;
+      trim_recycled(desc, 0);
+      if (desc.strategy == SINGLETON && desc.storage)
+        m_pool.deallocate(desc.storage, desc.storage_size);
+    }
+    for (size_t i = 0; i < m_service_count; ++i) {
+      release_name(entry_at(i).name);
+      entry_at(i).~RegistryEntry();
+    }
+#if KNOT_DYNAMIC_REGISTRY
+    for (size_t i = 0; i < m_service_count; ++i)
+      m_pool.deallocate(m_registry[i], sizeof(RegistryEntry));
+    m_pool.deallocate(m_spare_entry, sizeof(RegistryEntry));
+    m_pool.deallocate(m_registry, sizeof(RegistryEntry*) * m_registry_capacity);
+    m_pool.deallocate(m_table, sizeof(RegistrySlot) * m_table_size);
+    release_transient_arrays();
+    m_pool.deallocate(m_creation_log,
+                      sizeof(CreationRecord) * m_creation_capacity);
+#endif
+    if (m_sealed) {
+      m_pool.deallocate(m_sealed_table.slots,
+                        sizeof(RegistrySlot) * m_sealed_table.slot_count);
+      m_pool.deallocate(m_sealed_table.displacements,
+                        sizeof(size_t) * m_sealed_table.group_count);
+    }
+    if (m_parent) FetchAdd(&m_parent->m_children, static_cast<size_t>(-1));
   }
 
   /** @brief Регистрация сервиса в контейнере
@@ -274,7 +1679,34 @@ class Container {
    */
   template <typename T>
   bool registerService(Strategy strategy = SINGLETON) {
-    return addService<T>(strategy, alloc_factory<T>());
+    return addService<T>(strategy, Factory<T>());
+  }
+
+  /** @brief Регистрация реализации под интерфейсом
+   * @details Сервис разрешается только по интерфейсу, конкретный тип
+   * вызывающему коду не виден:
+   * @code
+   * container.registerService<ILogger, FileLogger>(SINGLETON, "app.log");
+   * ILogger* log = container.resolve<ILogger>();
+   * @endcode
+   * Экземпляр C размещается в хранилище, выделенном под C, а в реестре
+   * сохраняется указатель на I, приведенный один раз при создании. Поэтому
+   * resolve<I>() для синглтона остается одной загрузкой указателя, без
+   * dynamic_cast и пересчета смещения базового класса. Деструктор C
+   * вызывается по адресу памяти экземпляра, что корректно при
+   * множественном наследовании.
+   * @tparam I Интерфейс, под которым регистрируется сервис
+   * @tparam C Реализация, производная от I
+   * @param strategy Стратегия создания сервиса
+   * @return true, если регистрация успешна, иначе false.
+   *
+   * @note Аргументы конструктора C передаются после стратегии, как и для
+   * registerService<T>(strategy, args...). resolveMany для таких сервисов
+   * недоступен.
+   */
+  template <typename I, typename C>
+  bool registerService(Strategy strategy = SINGLETON) {
+    return addBinding<I, C>(strategy, Factory<C>());
   }
 
   /** @brief Регистрация экземпляра сервиса в контейнере
@@ -290,12 +1722,52 @@ class Container {
    */
   template <typename T>
   bool registerInstance(T* instance) {
-    if (!instance || m_service_count >= KNOT_MAX_SERVICES) return false;
-    void* tid = TypeId<T>();
-    if (find_entry(tid)) return false;
-    RegistryEntry& entry = m_registry[m_service_count++];
-    entry.type = tid;
-    entry.desc.factory = NULL;
+    if (!instance || find_local<T>() || !reserve_entry()) return false;
+    RegistryEntry& entry = add_entry<T>();
+    entry.desc.resetFactory();
+    entry.desc.strategy = EXTERNAL;
+    entry.desc.instance = instance;
+    entry.desc.storage = NULL;
+    return true;
+  }
+
+  /** @brief Регистрация сервиса с ключом
+   * @details Позволяет зарегистрировать несколько сервисов одного типа под
+   * разными ключами, например по пулу соединений на шард:
+   * @code
+   * container.registerService<Pool>(1, SINGLETON, "db-1");
+   * container.registerService<Pool>("replica", SINGLETON, "db-2");
+   * Pool* p = container.resolve<Pool>(1);
+   * @endcode
+   * Регистрации с ключом не пересекаются с регистрацией того же типа без
+   * ключа, а целые ключи - со строковыми. Строка ключа копируется в пул.
+   * @tparam T Тип сервиса
+   * @param key Ключ: целое число или строка
+   * @param strategy Стратегия создания сервиса
+   * @return true, если регистрация успешна; false, если ключ уже занят, его
+   * хеш совпал с хешем другого строкового ключа или нет места.
+   */
+  template <typename T>
+  bool registerService(const ServiceKey& key, Strategy strategy = SINGLETON) {
+    return addService<T>(key, strategy, Factory<T>());
+  }
+
+  /** @brief Регистрация экземпляра сервиса с ключом
+   * @tparam T Тип сервиса
+   * @param key Ключ: целое число или строка
+   * @param instance Указатель на экземпляр сервиса
+   * @return true, если регистрация успешна, иначе false.
+   */
+  template <typename T>
+  bool registerInstance(const ServiceKey& key, T* instance) {
+    if (!instance || find_keyed_slot<T>(key) || !reserve_entry() ||
+        !reserve_keyed())
+      return false;
+    char* name = copy_name(key);
+    if (key.name && !name) return false;
+    RegistryEntry& entry = add_entry<T>(&key);
+    entry.name = name;
+    entry.desc.resetFactory();
     entry.desc.strategy = EXTERNAL;
     entry.desc.instance = instance;
     entry.desc.storage = NULL;
@@ -303,6 +1775,8 @@ class Container {
   }
 
   REGISTER_GEN  // Макрос для регистрации сервисов с различной арностью
+  BIND_REGISTER_GEN  // Макрос для регистрации реализаций под интерфейсом
+  KEYED_REGISTER_GEN  // Макрос для регистрации сервисов с ключом
 
       /** @brief Получение зарегистрированного сервиса по его типу
        * @details Этот метод позволяет получить зарегистрированный сервис по
@@ -314,67 +1788,536 @@ class Container {
        * @note Если сервис зарегистрирован как SINGLETON, он будет создан при
        * первом вызове resolve и сохранен для последующих вызовов. Если сервис
        * зарегистрирован как TRANSIENT, он будет создан каждый раз при вызове
-       * resolve.
+       * resolve. Сервисы SCOPED контейнер сам не создает: они
+       * разрешаются через Scope, и здесь возвращается NULL. Исключение -
+       * зависимости, которые фабрика разрешает, пока Scope создает сервис:
+       * они берутся из этой области видимости.
        */
       template <typename T>
       T* resolve() {
-    RegistryEntry* entry = find_entry(TypeId<T>());
+    return resolve_entry<T>(find_entry<T>());
+  }
+
+  /** @brief Получение сервиса, зарегистрированного с ключом
+   * @details Поиск выполняется в хеш-таблице по паре (тип, ключ) и обычно
+   * сводится к одному сравнению. Для многократного разрешения одного ключа
+   * удобнее получить дескриптор через handle<T>(key).
+   * @tparam T Тип сервиса
+   * @param key Ключ регистрации: целое число или строка
+   * @return Указатель на сервис или NULL, если такой ключ не
+   * зарегистрирован.
+   */
+  template <typename T>
+  T* resolve(const ServiceKey& key) {
+    return resolve_entry<T>(find_keyed<T>(key));
+  }
+
+  /** @brief Получение сервиса по дескриптору
+   * @details Запись реестра уже найдена, поэтому поиск не выполняется.
+   * @tparam T Тип сервиса
+   * @param handle Дескриптор, полученный из handle<T>()
+   * @return Указатель на сервис или NULL
+   */
+  template <typename T>
+  T* resolve(ServiceHandle<T> handle) {
+    return resolve_entry<T>(handle.entry);
+  }
+
+  /** @brief Получение дескриптора сервиса
+   * @tparam T Тип сервиса
+   * @return Дескриптор; недействителен, если сервис не зарегистрирован
+   */
+  template <typename T>
+  ServiceHandle<T> handle() {
+    ServiceHandle<T> result;
+    result.entry = find_entry<T>();
+    return result;
+  }
+
+  /** @brief Получение дескриптора сервиса, зарегистрированного с ключом
+   * @details Ключ ищется один раз; последующие resolve(handle) не хешируют
+   * ключ и не обращаются к таблице.
+   * @tparam T Тип сервиса
+   * @param key Ключ регистрации
+   * @return Дескриптор; недействителен, если ключ не зарегистрирован
+   */
+  template <typename T>
+  ServiceHandle<T> handle(const ServiceKey& key) {
+    ServiceHandle<T> result;
+    result.entry = find_keyed<T>(key);
+    return result;
+  }
+
+  /** @brief Получение ссылки на сервис для многократного разрешения
+   * @details Запись реестра ищется один раз. Последующие вызовы
+   * ServiceRef::get() не выполняют поиск типа:
+   * @code
+   * Knot::ServiceRef<Clock> clock = container.ref<Clock>();
+   * for (size_t i = 0; i < n; ++i) stamps[i] = clock->now();
+   * @endcode
+   * @tparam T Тип сервиса
+   * @return Ссылка; недействительна, если сервис не зарегистрирован
+   */
+  template <typename T>
+  ServiceRef<T> ref() {
+    return ServiceRef<T>(this, find_entry<T>());
+  }
+
+  /** @brief Получение ссылки на сервис, зарегистрированный с ключом
+   * @tparam T Тип сервиса
+   * @param key Ключ регистрации
+   * @return Ссылка; недействительна, если ключ не зарегистрирован
+   */
+  template <typename T>
+  ServiceRef<T> ref(const ServiceKey& key) {
+    return ServiceRef<T>(this, find_keyed<T>(key));
+  }
+
+  /** @brief Получение временного сервиса с дескриптором
+   * @details Работает как resolve(), но для TRANSIENT сервиса дополнительно
+   * заполняет дескриптор, по которому экземпляр можно проверить или
+   * уничтожить за O(1).
+   * @tparam T Тип сервиса, который нужно получить
+   * @param handle Дескриптор созданного экземпляра. Для сервисов с другими
+   * стратегиями и при ошибке становится недействительным.
+   * @return Указатель на сервис типа T, или NULL.
+   */
+  template <typename T>
+  T* resolve(TransientHandle& handle) {
+    handle = TransientHandle();
+    RegistryEntry* entry = find_entry<T>();
     if (!entry) return NULL;
-    Descriptor& desc = entry->desc;
-    switch (desc.strategy) {
-      case SINGLETON: {
-        if (!desc.instance) desc.instance = desc.factory->create(desc.storage);
-        return static_cast<T*>(desc.instance);
-      }
-      case TRANSIENT: {
-        if (m_transient_count >= KNOT_MAX_TRANSIENTS) return NULL;
-        void* mem = m_pool.allocate<T>();
-        if (!mem) return NULL;
-        T* ptr = static_cast<T*>(desc.factory->create(mem));
-        m_transients[m_transient_count].factory = desc.factory;
-        m_transients[m_transient_count].ptr = ptr;
-        m_transients[m_transient_count].alloc_size = sizeof(T);
-        ++m_transient_count;
-        return ptr;
-      }
-      case EXTERNAL: {
-        if (!desc.instance) return NULL;
-        return static_cast<T*>(desc.instance);
+    if (entry->desc.strategy != TRANSIENT) return resolve<T>();
+    KNOT_INSTRUMENT(entry->desc.counters.resolved());
+    T* instance = create_transient<T>(*entry, &handle);
+    KNOT_INSTRUMENT(if (!instance) entry->desc.counters.failed());
+    return instance;
+  }
+
+  /** @brief Пакетное создание временных сервисов
+   * @details Создает count экземпляров TRANSIENT сервиса подряд в одном
+   * выровненном блоке памяти. Пакет учитывается как одна запись временного
+   * сервиса и уничтожается целиком: через destroyTransient(out[0]),
+   * destroyTransient(handle) или destroyAllTransients().
+   * @tparam T Тип сервиса
+   * @param count Количество экземпляров
+   * @param out Массив из count указателей на созданные экземпляры. Экземпляры
+   * лежат подряд, поэтому out[i] == out[0] + i.
+   * @param handle Дескриптор пакета. При ошибке становится недействительным.
+   * @return true, если создан весь пакет. Для сервисов с другими
+   * стратегиями, для реализаций, зарегистрированных под интерфейсом, при
+   * нехватке памяти и при count, для которого sizeof(T) * count не
+   * помещается в size_t, возвращается false.
+   */
+  template <typename T>
+  bool resolveMany(size_t count, T** out, TransientHandle& handle) {
+    handle = TransientHandle();
+    if (!count || count > static_cast<size_t>(-1) / sizeof(T)) return false;
+    RegistryEntry* entry = find_entry<T>();
+    if (!entry || entry->desc.strategy != TRANSIENT || entry->desc.bound)
+      return false;
+    KNOT_INSTRUMENT(entry->desc.counters.resolved());
+    T* first = create_transient<T>(*entry, &handle, count);
+    KNOT_INSTRUMENT(if (!first) entry->desc.counters.failed());
+    if (!first) return false;
+    for (size_t i = 0; i < count; ++i) out[i] = first + i;
+    return true;
+  }
+
+  /** @brief Пакетное создание временных сервисов
+   * @details То же, что resolveMany(count, out, handle), без дескриптора.
+   * @tparam T Тип сервиса
+   * @param count Количество экземпляров
+   * @param out Массив из count указателей на созданные экземпляры
+   * @return true, если создан весь пакет
+   */
+  template <typename T>
+  bool resolveMany(size_t count, T** out) {
+    TransientHandle handle;
+    return resolveMany<T>(count, out, handle);
+  }
+
+  /** @brief Получение внедряемой зависимости
+   * @details Возвращает легковесный объект, который разрешает сервис D при
+   * создании зависимого сервиса, а не при регистрации. Передается в
+   * registerService вместо уже созданного экземпляра:
+   * @code
+   * container.registerService<Complex>(TRANSIENT, container.inject<Dep1>(),
+   *                                    container.inject<Dep2>());
+   * @endcode
+   * Таким образом создается только та часть графа зависимостей, которая
+   * достижима из реально разрешаемых сервисов. Циклическая зависимость
+   * разрешается в NULL.
+   * @tparam D Тип зависимости
+   * @return Объект, приводимый к D*
+   */
+  template <typename D>
+  Inject<D> inject() {
+    return Inject<D>(this);
+  }
+
+  /** @brief Получение отложенной зависимости
+   * @details В отличие от inject(), зависимость не разрешается и при
+   * создании зависимого сервиса: конструктор получает Lazy<D>, который
+   * разрешает D при первом разыменовании. Дорогие синглтоны, нужные только
+   * на редких путях, не создаются, пока к ним не обратились:
+   * @code
+   * container.registerService<Report>(SINGLETON, container.lazy<Index>());
+   * @endcode
+   * @tparam D Тип зависимости
+   * @return Объект Lazy<D>, еще не разрешенный
+   */
+  template <typename D>
+  Lazy<D> lazy() {
+    return Lazy<D>(this);
+  }
+
+  /** @brief Предварительное создание всех синглтонов
+   * @details Строит граф зависимостей зарегистрированных сервисов по
+   * внедряемым зависимостям (inject) и разбивает синглтоны на уровни: сначала
+   * создаются синглтоны без зависимостей, затем зависящие только от них и
+   * т.д. Синглтоны одного уровня независимы и при KNOT_THREAD_SAFE=1
+   * создаются параллельно на threads потоках, публикуя экземпляры в
+   * Descriptor::instance. Без KNOT_THREAD_SAFE создание выполняется
+   * последовательно в том же порядке уровней.
+   * @param threads Количество потоков, включая вызывающий
+   * @return Количество созданных синглтонов
+   */
+  size_t warmUp(size_t threads = 1) {
+#if KNOT_DYNAMIC_REGISTRY
+    if (!m_service_count) return 0;
+    size_t scratch_size = m_service_count * (sizeof(size_t) +
+                                             sizeof(RegistryEntry*) + 1);
+    void* scratch = allocate_region(scratch_size);
+    if (!scratch) return 0;
+    size_t* levels = static_cast<size_t*>(scratch);
+    RegistryEntry** batch =
+        reinterpret_cast<RegistryEntry**>(levels + m_service_count);
+    unsigned char* marks =
+        reinterpret_cast<unsigned char*>(batch + m_service_count);
+    std::memset(marks, 0, m_service_count);
+#else
+    size_t levels[KNOT_MAX_SERVICES];
+    unsigned char marks[KNOT_MAX_SERVICES] = {};
+    RegistryEntry* batch[KNOT_MAX_SERVICES];
+#endif
+    size_t max_level = 0;
+    for (size_t i = 0; i < m_service_count; ++i) {
+      if (entry_at(i).desc.strategy != SINGLETON) continue;
+      size_t level = dependency_level(i, levels, marks);
+      if (level > max_level) max_level = level;
+    }
+    size_t built = 0;
+    for (size_t level = 0; level <= max_level; ++level) {
+      size_t count = 0;
+      for (size_t i = 0; i < m_service_count; ++i) {
+        Descriptor& desc = entry_at(i).desc;
+        if (desc.strategy == SINGLETON && levels[i] == level &&
+            !LoadAcquire(&desc.instance))
+          batch[count++] = &entry_at(i);
       }
-      default:
-        return NULL;
+      if (!count) continue;
+      WarmUpTask task = {this, batch, count, 0, 0};
+      RunParallel(&Container::warm_up_worker, &task,
+                  threads < count ? threads : count);
+      built += task.built;
+    }
+#if KNOT_DYNAMIC_REGISTRY
+    release_region(scratch, scratch_size);
+#endif
+    return built;
+  }
+
+  /** @brief Запечатывание реестра после завершения регистрации
+   * @details Строит по всем записям реестра неизменяемую совершенную
+   * хеш-таблицу (SealedTable) и запрещает дальнейшую регистрацию: все
+   * методы регистрации возвращают false. Типы из прямой таблицы m_slots
+   * по-прежнему находятся одним чтением из нее, а типы за ее пределами и
+   * регистрации с ключом - одним сравнением в SealedTable вместо линейного
+   * перебора или пробирования.
+   *
+   * После seal() реестр больше не меняется, поэтому при KNOT_THREAD_SAFE=1
+   * поиск записей из любых потоков не требует синхронизации, а поздняя
+   * регистрация из другого потока завершается ошибкой, а не гонкой с
+   * поиском.
+   *
+   * Таблица выделяется из пула контейнера. Если построить ее не удалось,
+   * контейнер остается незапечатанным.
+   * @return true, если реестр запечатан (в том числе ранее)
+   *
+   * @warning Вызывается до начала параллельной работы с контейнером.
+   */
+  bool seal() {
+    if (m_sealed) return true;
+    size_t count = m_service_count;
+    SealedTable table = {NULL, 0, 0, NULL, 2, 0};
+    while (table.group_count * SEAL_GROUP_SIZE < count) table.group_count *= 2;
+    table.group_shift = hash_shift(table.group_count);
+    size_t scratch_size = sizeof(size_t) * (2 * count + table.group_count + 1);
+    size_t* hashes = static_cast<size_t*>(allocate_region(scratch_size));
+    if (!hashes) return false;
+    size_t* order = hashes + count;
+    size_t* starts = order + count;
+    std::memset(starts, 0, sizeof(size_t) * (table.group_count + 1));
+    for (size_t i = 0; i < count; ++i) {
+      hashes[i] = HashTypeId(entry_at(i).type, entry_at(i).key);
+      ++starts[(hashes[i] >> table.group_shift) + 1];
     }
+    for (size_t g = 0; g < table.group_count; ++g) starts[g + 1] += starts[g];
+    for (size_t i = 0; i < count; ++i)
+      order[starts[hashes[i] >> table.group_shift]++] = i;
+    for (size_t g = table.group_count; g > 0; --g) starts[g] = starts[g - 1];
+    starts[0] = 0;
+    table.displacements = static_cast<size_t*>(
+        allocate_region(sizeof(size_t) * table.group_count));
+    table.slot_count = 2;
+    while (table.slot_count * 4 < count * 5) table.slot_count *= 2;
+    bool built = false;
+    while (table.displacements && table.slot_count <= count * 64 + 2) {
+      size_t bytes = sizeof(RegistrySlot) * table.slot_count;
+      table.slots = static_cast<RegistrySlot*>(allocate_region(bytes));
+      if (!table.slots) break;
+      std::memset(table.slots, 0, bytes);
+      table.slot_shift = hash_shift(table.slot_count);
+      built = seal_groups(table, hashes, order, starts);
+      if (built) break;
+      release_region(table.slots, bytes);
+      table.slot_count *= 2;
+    }
+    release_region(hashes, scratch_size);
+    if (!built) {
+      if (table.displacements)
+        release_region(table.displacements,
+                       sizeof(size_t) * table.group_count);
+      return false;
+    }
+    m_sealed_table = table;
+    m_sealed = true;
+    return true;
   }
 
+  /** @brief Проверка, что реестр запечатан
+   * @return true после успешного вызова seal()
+   */
+  bool isSealed() const { return m_sealed; }
+
   /** @brief Уничтожение всех синглтон сервисов
-   * @note Этот метод освобождает память, занятую всеми синглтон сервисами, и
-   * вызывает их деструкторы.
+   * @details Созданные синглтоны уничтожаются по журналу созданий в
+   * порядке, обратном порядку создания; несозданные не затрагиваются.
+   * @note Этот метод освобождает память, занятую созданными синглтон
+   * сервисами, и вызывает их деструкторы. Хранилище синглтона будет выделено
+   * повторно при следующем вызове resolve. Блокировка контейнера
+   * удерживается на все время уничтожения, поэтому метод можно вызывать
+   * параллельно с созданием временных сервисов, но не параллельно с
+   * разрешением синглтонов, которые он уничтожает.
    */
   void destroyAllSingletons() {
-    for (size_t i = 0; i < m_service_count; ++i) {
-      Descriptor& desc = m_registry[i].desc;
-      if (desc.strategy == SINGLETON && desc.instance) {
-        size_t alloc_size = sizeof(desc.instance);
-        desc.factory->destroy(desc.instance);
-        if (desc.storage) {
-          m_pool.deallocate(desc.storage, alloc_size);
-          desc.storage = NULL;
-        }
-        desc.instance = NULL;
-      }
-    }
+    LockGuard guard(m_mutex);
+    destroy_created(true, false);
   }
 
   /** @brief Уничтожение всех временных сервисов
+   * @details Экземпляры уничтожаются по журналу созданий в порядке,
+   * обратном порядку создания. Записи, фабрики которых в этот момент
+   * выполняются в других потоках, остаются занятыми: такие экземпляры
+   * публикуются после возврата из метода и не уничтожаются им.
    * @note Этот метод освобождает память, занятую всеми временными сервисами,
    * и вызывает их деструкторы.
    */
   void destroyAllTransients() {
-    for (size_t i = 0; i < m_transient_count; ++i) {
-      destroyTransientAt(i);
+    LockGuard guard(m_mutex);
+    destroy_created(false, true);
+    // Уничтоженные записи обнулены; дескриптор остается только у записей,
+    // которые сейчас создаются.
+    size_t building = 0;
+    m_free_transient_count = 0;
+    for (size_t idx = m_transient_high; idx-- > 0;) {
+      if (m_transients[idx].desc)
+        ++building;
+      else
+        m_free_transients[m_free_transient_count++] = idx;
+    }
+    if (!building) {
+      m_transient_high = 0;
+      m_free_transient_count = 0;
+    }
+    m_transient_count = building;
+  }
+
+  /** @brief Начало запроса
+   * @details До вызова endRequest() TRANSIENT экземпляры размещаются в
+   * арене запроса - отдельной области пула контейнера, а не в самом пуле.
+   * Регистрации, фабрики и синглтоны остаются в пуле и запрос переживают.
+   * Область выделяется при первом запросе и используется повторно:
+   * @code
+   * while (next(&message)) {
+   *   container.beginRequest();
+   *   container.resolve<Handler>()->handle(message);
+   *   container.endRequest();
+   * }
+   * @endcode
+   * @param arena_bytes Размер арены запроса в байтах. Если ранее выделенная
+   * область меньше, она заменяется новой.
+   * @return true, если запрос начат; false, если запрос уже идет или пул не
+   * может выделить арену
+   *
+   * @note Если арена заполнена, resolve TRANSIENT сервиса возвращает NULL.
+   * destroyTransient() внутри запроса уничтожает экземпляр сразу, но его
+   * память возвращается только при сбросе арены в endRequest().
+   * @warning beginRequest() и endRequest() не вызываются параллельно с
+   * разрешением сервисов.
+   */
+  bool beginRequest(size_t arena_bytes = KNOT_REQUEST_ARENA_BYTES) {
+    LockGuard guard(m_mutex);
+    if (m_in_request) return false;
+    if (arena_bytes > m_request_region_size) {
+      void* region =
+          m_pool.allocateRaw(arena_bytes, AlignmentOf<MaxAlign>::value);
+      if (!region) return false;
+      if (m_request_region)
+        m_pool.deallocate(m_request_region, m_request_region_size);
+      m_request_region = region;
+      m_request_region_size = arena_bytes;
+      m_request_arena.reset(region, arena_bytes);
+    }
+    m_in_request = true;
+    return true;
+  }
+
+  /** @brief Завершение запроса
+   * @details Уничтожает еще живые экземпляры запроса в порядке, обратном
+   * созданию, и возвращает арену в начало одним действием. Стоимость
+   * пропорциональна количеству созданных за запрос экземпляров. Дескрипторы
+   * и указатели этих экземпляров становятся недействительными.
+   */
+  void endRequest() {
+    LockGuard guard(m_mutex);
+    for (RequestRecord* record = m_request_log; record;
+         record = record->prev) {
+      if (find_transient(record->handle))
+        releaseTransientAt(record->handle.index);
     }
-    m_transient_count = 0;
+    m_request_log = NULL;
+    m_request_arena.reset();
+    m_in_request = false;
+  }
+
+  /** @brief Проверка, что запрос начат
+   * @return true между beginRequest() и endRequest()
+   */
+  bool inRequest() const { return m_in_request; }
+
+  /** @brief Настройка списка повторного использования временного сервиса
+   * @details Память уничтоженных экземпляров TRANSIENT сервиса возвращается
+   * в список этого сервиса, а не в пул, и следующий resolve берет ее из
+   * списка без обращения к пулу. Пакеты resolveMany в список не попадают.
+   * По умолчанию список ограничен KNOT_RECYCLE_LIMIT блоками.
+   * @tparam T Тип временного сервиса
+   * @param limit Максимальное количество блоков; 0 отключает список.
+   * Лишние блоки сразу возвращаются в пул.
+   * @return true, если сервис зарегистрирован в этом контейнере как
+   * TRANSIENT
+   */
+  template <typename T>
+  bool setRecycleLimit(size_t limit) {
+    RegistryEntry* entry = find_local<T>();
+    if (!entry || entry->desc.strategy != TRANSIENT) return false;
+    LockGuard guard(m_mutex);
+    entry->desc.recycle_limit = limit;
+    trim_recycled(entry->desc, limit);
+    return true;
+  }
+
+  /** @brief Статистика повторного использования памяти временного сервиса
+   * @tparam T Тип временного сервиса
+   * @return Счетчики попаданий и промахов и состояние списка. Для
+   * незарегистрированного сервиса все значения равны нулю.
+   */
+  template <typename T>
+  RecycleStats recycleStats() {
+    RecycleStats stats = {0, 0, 0, 0};
+    RegistryEntry* entry = find_entry<T>();
+    if (!entry) return stats;
+    LockGuard guard(m_mutex);
+    stats.hits = entry->desc.recycle_hits;
+    stats.misses = entry->desc.recycle_misses;
+    stats.cached = entry->desc.recycle_count;
+    stats.limit = entry->desc.recycle_limit;
+    return stats;
+  }
+
+#if KNOT_POOL_STATS
+  /** @brief Статистика пула памяти контейнера (KNOT_POOL_STATS=1)
+   * @details Снимок берется под блокировкой контейнера. Пики и гистограммы
+   * накапливаются с момента создания контейнера, поэтому после прогона
+   * рабочей нагрузки peak_offset показывает размер буфера, которого хватит
+   * для Container(uint8_t (&buffer)[N]).
+   * @return Снимок MemoryPool::getStats()
+   */
+  PoolStats poolStats() {
+    LockGuard guard(m_mutex);
+    return m_pool.getStats();
+  }
+#endif
+
+#if KNOT_INSTRUMENTATION
+  /** @brief Счетчики сервиса (KNOT_INSTRUMENTATION=1)
+   * @tparam T Тип сервиса
+   * @return Снимок счетчиков. Для незарегистрированного сервиса все значения
+   * равны нулю.
+   */
+  template <typename T>
+  ServiceStats serviceStats() {
+    return stats_of(find_entry<T>());
+  }
+
+  /** @brief Счетчики сервиса, зарегистрированного с ключом
+   * @tparam T Тип сервиса
+   * @param key Ключ регистрации
+   * @return Снимок счетчиков или нули, если регистрации нет
+   */
+  template <typename T>
+  ServiceStats serviceStats(const ServiceKey& key) {
+    return stats_of(find_keyed<T>(key));
+  }
+
+  /** @brief Снимок счетчиков всех записей реестра
+   * @details Записи копируются в порядке регистрации. Если out меньше
+   * реестра, копируются первые capacity записей.
+   * @param out Массив для снимка
+   * @param capacity Размер массива out
+   * @return Количество записей в реестре
+   */
+  size_t snapshotStats(ServiceStats* out, size_t capacity) {
+    size_t count = m_service_count;
+    for (size_t i = 0; i < count && i < capacity; ++i)
+      out[i] = stats_of(&entry_at(i));
+    return count;
+  }
+
+  /** @brief Обход счетчиков всех записей реестра
+   * @details Вызывает visitor(const ServiceStats&) для каждой записи в
+   * порядке регистрации, не требуя массива под снимок.
+   * @tparam V Тип посетителя
+   * @param visitor Функция или функциональный объект
+   * @return Посетитель после обхода, как в std::for_each
+   */
+  template <typename V>
+  V visitStats(V visitor) {
+    for (size_t i = 0; i < m_service_count; ++i)
+      visitor(stats_of(&entry_at(i)));
+    return visitor;
+  }
+
+  /** @brief Обнуление счетчиков всех записей реестра
+   * @note Обнуление не атомарно относительно одновременных resolve: учет,
+   * выполняемый в этот момент другими потоками, может частично сохраниться.
+   */
+  void resetStats() {
+    for (size_t i = 0; i < m_service_count; ++i)
+      std::memset(&entry_at(i).desc.counters, 0, sizeof(ServiceCounters));
   }
+#endif
 
   /** @brief Уничтожение временного сервиса по указателю
    * @details Этот метод освобождает память, занятую временным сервисом, и
@@ -385,19 +2328,185 @@ class Container {
    * @param ptr Указатель на временный сервис, который нужно уничтожить
    *
    * @note Этот метод используется для управления жизненным циклом временных
-   * сервисов, которые были созданы с помощью метода .resolve().
+   * сервисов, которые были созданы с помощью метода .resolve(). Пакет,
+   * созданный resolveMany, уничтожается целиком по первому экземпляру.
    */
   template <typename T>
   void destroyTransient(T* ptr) {
-    for (size_t idx = 0; idx < m_transient_count; idx++) {
-      if (m_transients[idx].ptr == ptr) {
-        destroyTransientAt(idx);
-        m_transients[idx] = m_transients[m_transient_count - 1];
-        m_transient_count--;
+    if (!ptr) return;
+    LockGuard guard(m_mutex);
+    for (size_t idx = 0; idx < m_transient_high; idx++) {
+      if (m_transients[idx].instance == ptr) {
+        releaseTransientAt(idx);
         break;
       }
     }
   }
+
+  /** @brief Уничтожение временного сервиса по дескриптору
+   * @details В отличие от уничтожения по указателю, не выполняет поиск и
+   * работает за O(1).
+   * @param handle Дескриптор, полученный из resolve(TransientHandle&)
+   * @return true, если сервис уничтожен; false, если дескриптор устарел или
+   * сервис уже был уничтожен.
+   */
+  bool destroyTransient(TransientHandle handle) {
+    LockGuard guard(m_mutex);
+    if (!find_transient(handle)) return false;
+    releaseTransientAt(handle.index);
+    return true;
+  }
+
+  /** @brief Проверка, что временный сервис по дескриптору еще существует
+   * @param handle Дескриптор временного сервиса
+   * @return true, если дескриптор ссылается на живой экземпляр
+   */
+  bool isAlive(TransientHandle handle) {
+    LockGuard guard(m_mutex);
+    return find_transient(handle) != NULL;
+  }
+
+  /** @brief Получение временного сервиса по дескриптору
+   * @tparam T Тип временного сервиса
+   * @param handle Дескриптор временного сервиса
+   * @return Указатель на экземпляр или NULL, если дескриптор устарел
+   */
+  template <typename T>
+  T* getTransient(TransientHandle handle) {
+    LockGuard guard(m_mutex);
+    TransientInfo* info = find_transient(handle);
+    return info ? static_cast<T*>(info->instance) : NULL;
+  }
+};
+
+/** @brief Зависимость, разрешаемая при создании сервиса
+ * @details Хранится в фабрике вместо указателя на зависимость. При вызове
+ * конструктора сервиса неявно приводится к D* и в этот момент разрешает D
+ * из контейнера, поэтому сохраняются стратегии зависимостей: синглтон
+ * создается один раз, временный сервис - для каждого зависимого экземпляра.
+ * SCOPED зависимость берется из области видимости, которая создает
+ * зависимый сервис; вне Scope и для синглтона она разрешается в NULL.
+ * Если D замыкает цикл, зависимый сервис не создается: разрешение всей
+ * цепочки возвращает NULL, а уже построенные ее звенья уничтожаются.
+ * Разорвать цикл можно отложенной зависимостью Lazy.
+ * @tparam D Тип зависимости
+ */
+template <typename D>
+class Inject {
+ private:
+  Container* m_container;  // Контейнер, из которого разрешается зависимость
+
+ public:
+  explicit Inject(Container* container) : m_container(container) {}
+
+  operator D*() const { return m_container->resolve<D>(); }
+};
+
+/** @brief Идентификатор зависимости внедряемого аргумента фабрики
+ * @details Позволяет фабрике сообщить контейнеру тип зависимости, не создавая
+ * ее. Используется warmUp для построения графа зависимостей.
+ * @tparam D Тип зависимости
+ * @return TypeId<D>()
+ */
+template <typename D>
+void* DependencyId(const Inject<D>&) {
+  return TypeId<D>();
+}
+
+/** @brief Ссылка на зарегистрированный сервис
+ * @details Хранит контейнер и найденную запись реестра, поэтому get() не
+ * ищет тип и не хеширует ключ. Для созданного синглтона и внешнего
+ * экземпляра get() - одно чтение Descriptor::instance с семантикой acquire.
+ * Для TRANSIENT сервиса, а также для синглтона, который еще не создан или
+ * был уничтожен, get() сразу переходит к созданию по записи. SCOPED сервисы
+ * разрешаются через Scope, для них get() ведет себя как
+ * Container::resolve().
+ *
+ * Ссылка занимает два указателя, копируется свободно и действительна, пока
+ * жив контейнер, который ее выдал.
+ * @tparam T Тип сервиса
+ */
+template <typename T>
+class ServiceRef {
+ private:
+  Container* m_container;  // Контейнер, выдавший ссылку
+  RegistryEntry* m_entry;  // Запись реестра или NULL
+
+ public:
+  ServiceRef() : m_container(NULL), m_entry(NULL) {}
+  ServiceRef(Container* container, RegistryEntry* entry)
+      : m_container(container), m_entry(entry) {}
+
+  /** @brief Получение сервиса
+   * @return Указатель на сервис или NULL
+   */
+  T* get() const {
+    if (!m_entry) return NULL;
+    void* instance = LoadAcquire(&m_entry->desc.instance);
+    if (instance) {
+      KNOT_INSTRUMENT(m_entry->desc.counters.resolved());
+      return static_cast<T*>(instance);
+    }
+    return m_container->resolve_entry<T>(m_entry);
+  }
+
+  T* operator->() const { return get(); }
+
+  /** @brief Проверка, что ссылка указывает на запись реестра
+   */
+  bool valid() const { return m_entry != NULL; }
+};
+
+/** @brief Зависимость, разрешаемая при первом разыменовании
+ * @details Передается в конструктор сервиса как аргумент фабрики и
+ * хранится в нем. Первое обращение разрешает D из контейнера и запоминает
+ * указатель, последующие обходятся одной проверкой. Для TRANSIENT
+ * зависимости запоминается один экземпляр на объект Lazy.
+ *
+ * Фабрика хранит неразрешенный образец, поэтому каждый созданный сервис
+ * получает свою копию. warmUp не считает отложенную зависимость ребром
+ * графа: она может создаваться позже зависимого сервиса, в том числе при
+ * циклических ссылках.
+ * @tparam D Тип зависимости
+ */
+template <typename D>
+class Lazy {
+ private:
+  Container* m_container;  // Контейнер, из которого разрешается зависимость
+  mutable void* m_instance;  // Разрешенная зависимость или NULL
+
+  /** @brief метод для первого разрешения зависимости
+   * @return Указатель на зависимость или NULL
+   */
+  D* resolve() const {
+    if (!m_container) return NULL;
+    D* instance = m_container->resolve<D>();
+    StoreRelease(&m_instance, instance);
+    return instance;
+  }
+
+ public:
+  Lazy() : m_container(NULL), m_instance(NULL) {}
+  explicit Lazy(Container* container)
+      : m_container(container), m_instance(NULL) {}
+
+  /** @brief Получение зависимости
+   * @details При первом вызове разрешает D. Если D не удалось разрешить,
+   * следующий вызов повторит попытку.
+   * @return Указатель на зависимость или NULL
+   */
+  D* get() const {
+    void* instance = LoadAcquire(&m_instance);
+    if (instance) return static_cast<D*>(instance);
+    return resolve();
+  }
+
+  D* operator->() const { return get(); }
+  D& operator*() const { return *get(); }
+
+  /** @brief Проверка, что зависимость уже разрешена
+   */
+  bool resolved() const { return LoadAcquire(&m_instance) != NULL; }
 };
 }  // namespace Knot
 
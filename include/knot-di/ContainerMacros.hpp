@@ -60,21 +60,80 @@
  * @note Расширение метода регистрации @link registerService для
  * различного количества аргументов.
  */
-#define R_GEN(N, TMPL, FUNC, TPS, ARGS)                                   \
-  template <typename T, EXPAND TMPL>                                      \
-  bool registerService(Strategy strategy, EXPAND FUNC) {                  \
-    void* mem = m_pool.allocate<Factory##N<T, EXPAND TPS>>();             \
-    if (!mem) return false;                                               \
-    IFactory* factory = new (mem) Factory##N<T, EXPAND TPS>(EXPAND ARGS); \
-    if (m_factory_count >= KNOT_MAX_SERVICES) return false;               \
-    m_factories[m_factory_count++] = factory;                             \
-    return addService<T>(strategy, factory);                              \
+#define R_GEN(N, TMPL, FUNC, TPS, ARGS)                                     \
+  template <typename T, EXPAND TMPL>                                        \
+  bool registerService(Strategy strategy, EXPAND FUNC) {                    \
+    return addService<T>(strategy, Factory##N<T, EXPAND TPS>(EXPAND ARGS)); \
   }
 
 #define REGISTER_GEN \
   R_ARITY_LIST(R_GEN)  // Макрос для генерации функций регистрации сервисов с
                        // различной арностью
 
+/** @brief Макрос для регистрации сервисов с ключом и различным количеством
+ * аргументов
+ * @details Генерирует перегрузки registerService(key, strategy, ...), которые
+ * регистрируют сервис под ключом ServiceKey.
+ * @param N Номер арности
+ * @param TMPL Шаблонные параметры
+ * @param FUNC Функция регистрации
+ * @param TPS Типы параметров
+ * @param ARGS Аргументы для конструктора фабрики
+ */
+#define KR_GEN(N, TMPL, FUNC, TPS, ARGS)                          \
+  template <typename T, EXPAND TMPL>                              \
+  bool registerService(const ServiceKey& key, Strategy strategy,  \
+                       EXPAND FUNC) {                             \
+    return addService<T>(key, strategy,                           \
+                         Factory##N<T, EXPAND TPS>(EXPAND ARGS)); \
+  }
+
+#define KEYED_REGISTER_GEN \
+  R_ARITY_LIST(KR_GEN)  // Макрос для генерации функций регистрации сервисов
+                        // с ключом
+
+/** @brief Макрос для регистрации реализаций под интерфейсом с различным
+ * количеством аргументов
+ * @details Генерирует перегрузки registerService<I, C>(strategy, ...), которые
+ * создают реализацию C и регистрируют ее под интерфейсом I.
+ * @param N Номер арности
+ * @param TMPL Шаблонные параметры
+ * @param FUNC Функция регистрации
+ * @param TPS Типы параметров
+ * @param ARGS Аргументы для конструктора фабрики
+ */
+#define B_GEN(N, TMPL, FUNC, TPS, ARGS)                              \
+  template <typename I, typename C, EXPAND TMPL>                     \
+  bool registerService(Strategy strategy, EXPAND FUNC) {             \
+    return addBinding<I, C>(strategy,                                \
+                            Factory##N<C, EXPAND TPS>(EXPAND ARGS)); \
+  }
+
+#define BIND_REGISTER_GEN \
+  R_ARITY_LIST(B_GEN)  // Макрос для генерации функций регистрации реализаций
+                       // под интерфейсом
+
+/** @brief Макрос для настройки фабрик статического контейнера
+ * @details Генерирует перегрузки StaticContainer::configure, которые
+ * конструируют фабрику сервиса из переданных аргументов и сохраняют ее в слоте
+ * сервиса.
+ * @param N Номер арности
+ * @param TMPL Шаблонные параметры
+ * @param FUNC Параметры функции
+ * @param TPS Типы параметров
+ * @param ARGS Аргументы для конструктора фабрики
+ */
+#define S_GEN(N, TMPL, FUNC, TPS, ARGS)                                  \
+  template <typename T, EXPAND TMPL>                                     \
+  bool configure(EXPAND FUNC) {                                          \
+    typedef typename FindService<Services, T>::Result::FactoryType Fac;  \
+    return slot<T>().configure(Fac(EXPAND ARGS));                        \
+  }
+
+#define CONFIGURE_GEN \
+  R_ARITY_LIST(S_GEN)  // Макрос для генерации функций настройки фабрик
+                       // статического контейнера
+
 // ------- Factory Macros -------
 /** @brief Макросы для создания фабрик с различным количеством аргументов
  * @details Эти макросы используются для создания фабрик, которые могут
@@ -82,22 +141,29 @@
  * управлять количеством параметров и создавать шаблоны кода.
  */
 #define F_ARITY_LIST(X)                                                       \
-  X(1, (typename A1), (A1 _arg1), (A1 arg1), (_arg1(arg1)), (_arg1))          \
+  X(1, (typename A1), (A1 _arg1), (A1 arg1), (_arg1(arg1)), (_arg1),          \
+    (DependencyId(_arg1)))                                                    \
   X(2, (typename A1, typename A2), (A1 _arg1; A2 _arg2), (A1 arg1, A2 arg2),  \
-    (_arg1(arg1), _arg2(arg2)), (_arg1, _arg2))                               \
+    (_arg1(arg1), _arg2(arg2)), (_arg1, _arg2),                               \
+    (DependencyId(_arg1), DependencyId(_arg2)))                               \
   X(3, (typename A1, typename A2, typename A3),                               \
     (A1 _arg1; A2 _arg2; A3 _arg3), (A1 arg1, A2 arg2, A3 arg3),              \
-    (_arg1(arg1), _arg2(arg2), _arg3(arg3)), (_arg1, _arg2, _arg3))           \
+    (_arg1(arg1), _arg2(arg2), _arg3(arg3)), (_arg1, _arg2, _arg3),           \
+    (DependencyId(_arg1), DependencyId(_arg2), DependencyId(_arg3)))          \
   X(4, (typename A1, typename A2, typename A3, typename A4),                  \
     (A1 _arg1; A2 _arg2; A3 _arg3; A4 _arg4),                                 \
     (A1 arg1, A2 arg2, A3 arg3, A4 arg4),                                     \
     (_arg1(arg1), _arg2(arg2), _arg3(arg3), _arg4(arg4)),                     \
-    (_arg1, _arg2, _arg3, _arg4))                                             \
+    (_arg1, _arg2, _arg3, _arg4),                                             \
+    (DependencyId(_arg1), DependencyId(_arg2), DependencyId(_arg3),           \
+     DependencyId(_arg4)))                                                    \
   X(5, (typename A1, typename A2, typename A3, typename A4, typename A5),     \
     (A1 _arg1; A2 _arg2; A3 _arg3; A4 _arg4; A5 _arg5),                       \
     (A1 arg1, A2 arg2, A3 arg3, A4 arg4, A5 arg5),                            \
     (_arg1(arg1), _arg2(arg2), _arg3(arg3), _arg4(arg4), _arg5(arg5)),        \
-    (_arg1, _arg2, _arg3, _arg4, _arg5))                                      \
+    (_arg1, _arg2, _arg3, _arg4, _arg5),                                      \
+    (DependencyId(_arg1), DependencyId(_arg2), DependencyId(_arg3),           \
+     DependencyId(_arg4), DependencyId(_arg5)))                               \
   X(6,                                                                        \
     (typename A1, typename A2, typename A3, typename A4, typename A5,         \
      typename A6),                                                            \
@@ -105,7 +171,9 @@
     (A1 arg1, A2 arg2, A3 arg3, A4 arg4, A5 arg5, A6 arg6),                   \
     (_arg1(arg1), _arg2(arg2), _arg3(arg3), _arg4(arg4), _arg5(arg5),         \
      _arg6(arg6)),                                                            \
-    (_arg1, _arg2, _arg3, _arg4, _arg5, _arg6))                               \
+    (_arg1, _arg2, _arg3, _arg4, _arg5, _arg6),                               \
+    (DependencyId(_arg1), DependencyId(_arg2), DependencyId(_arg3),           \
+     DependencyId(_arg4), DependencyId(_arg5), DependencyId(_arg6)))          \
   X(7,                                                                        \
     (typename A1, typename A2, typename A3, typename A4, typename A5,         \
      typename A6, typename A7),                                               \
@@ -113,7 +181,10 @@
     (A1 arg1, A2 arg2, A3 arg3, A4 arg4, A5 arg5, A6 arg6, A7 arg7),          \
     (_arg1(arg1), _arg2(arg2), _arg3(arg3), _arg4(arg4), _arg5(arg5),         \
      _arg6(arg6), _arg7(arg7)),                                               \
-    (_arg1, _arg2, _arg3, _arg4, _arg5, _arg6, _arg7))                        \
+    (_arg1, _arg2, _arg3, _arg4, _arg5, _arg6, _arg7),                        \
+    (DependencyId(_arg1), DependencyId(_arg2), DependencyId(_arg3),           \
+     DependencyId(_arg4), DependencyId(_arg5), DependencyId(_arg6),           \
+     DependencyId(_arg7)))                                                    \
   X(8,                                                                        \
     (typename A1, typename A2, typename A3, typename A4, typename A5,         \
      typename A6, typename A7, typename A8),                                  \
@@ -122,7 +193,10 @@
     (A1 arg1, A2 arg2, A3 arg3, A4 arg4, A5 arg5, A6 arg6, A7 arg7, A8 arg8), \
     (_arg1(arg1), _arg2(arg2), _arg3(arg3), _arg4(arg4), _arg5(arg5),         \
      _arg6(arg6), _arg7(arg7), _arg8(arg8)),                                  \
-    (_arg1, _arg2, _arg3, _arg4, _arg5, _arg6, _arg7, _arg8))
+    (_arg1, _arg2, _arg3, _arg4, _arg5, _arg6, _arg7, _arg8),                 \
+    (DependencyId(_arg1), DependencyId(_arg2), DependencyId(_arg3),           \
+     DependencyId(_arg4), DependencyId(_arg5), DependencyId(_arg6),           \
+     DependencyId(_arg7), DependencyId(_arg8)))
 
 /** @brief Макрос для создания фабрик с различным количеством аргументов
  * @details Этот макрос используется для создания шаблонов фабрик, которые могут
@@ -134,11 +208,12 @@
  * @param ARGS Аргументы конструктора фабрики
  * @param CONSTR Конструктор фабрики
  * @param CREATE Создание объекта
+ * @param DEPS Идентификаторы внедряемых зависимостей аргументов
  *
  * @note Расширение метода создания фабрики для различного количества
  * аргументов. @link Factory::create
  */
-#define F_GEN(N, TMPL, FIELDS, ARGS, CONSTR, CREATE)                        \
+#define F_GEN(N, TMPL, FIELDS, ARGS, CONSTR, CREATE, DEPS)                  \
   template <typename T, EXPAND TMPL>                                        \
   class Factory##N : public IFactory {                                      \
     EXPAND FIELDS;                                                          \
@@ -146,11 +221,18 @@
    public:                                                                  \
     Factory##N(EXPAND ARGS) : EXPAND CONSTR {}                              \
     virtual void* create(void* buffer) {                                    \
-      return buffer ? new (buffer) T(EXPAND CREATE) : new T(EXPAND CREATE); \
+      return new (buffer) T(EXPAND CREATE);                                 \
     }                                                                       \
     void destroy(void* instance) {                                          \
       if (instance) static_cast<T*>(instance)->~T();                        \
     }                                                                       \
+    size_t dependencies(void** out) const {                                 \
+      void* ids[] = {EXPAND DEPS};                                          \
+      size_t count = 0;                                                     \
+      for (size_t i = 0; i < N; ++i)                                        \
+        if (ids[i]) out[count++] = ids[i];                                  \
+      return count;                                                         \
+    }                                                                       \
   };
 
 #define FACTORY_GEN \
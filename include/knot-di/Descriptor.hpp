@@ -10,29 +10,330 @@
 #ifndef DESCRIPTOR_HPP
 #define DESCRIPTOR_HPP
 
+#include <cstddef>
+#include <new>
+
 #include "Factory.hpp"
 #include "Strategy.hpp"
+#include "Sync.hpp"
+#include "Util.hpp"
+
+#if KNOT_INSTRUMENTATION
+#include <time.h>
+#define KNOT_INSTRUMENT(code) code  // Код учета ServiceCounters
+#else
+#define KNOT_INSTRUMENT(code)  // Учет выключен, код не компилируется
+#endif
+
+#ifndef KNOT_FACTORY_INLINE_BYTES
+#define KNOT_FACTORY_INLINE_BYTES 80  // Размер встроенного буфера фабрики
+#endif
+
+#ifndef KNOT_RECYCLE_LIMIT
+#define KNOT_RECYCLE_LIMIT 16  // Число блоков в списке повторного
+                               // использования временного сервиса
+#endif
 
 namespace Knot {
+#if KNOT_INSTRUMENTATION
+/** @brief Монотонное время в наносекундах
+ * @details Значение может переполняться на 32-битных платформах, поэтому
+ * используется только разность двух отсчетов.
+ * @return Текущее время CLOCK_MONOTONIC
+ */
+inline size_t MonotonicNanos() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<size_t>(ts.tv_sec) * 1000000000u +
+         static_cast<size_t>(ts.tv_nsec);
+}
+
+/** @brief Счетчики разрешений и созданий сервиса
+ * @details Ведутся для каждой записи реестра при KNOT_INSTRUMENTATION=1.
+ * Обновляются атомарно, поэтому в потокобезопасном режиме их можно читать во
+ * время работы контейнера. Время измеряется в наносекундах.
+ */
+struct ServiceCounters {
+  size_t resolves;          // Вызовы resolve для сервиса
+  size_t constructs;        // Экземпляры, созданные фабрикой
+  size_t construct_ns;      // Суммарное время работы фабрики
+  size_t max_construct_ns;  // Наибольшее время одного создания
+  size_t bytes;             // Память, выделенная из пула под экземпляры
+  size_t failures;          // Разрешения, вернувшие NULL
+
+  void resolved() { FetchAdd(&resolves, 1); }
+  void failed() { FetchAdd(&failures, 1); }
+  void allocated(size_t size) { FetchAdd(&bytes, size); }
+
+  /** @brief Учет завершенного создания
+   * @param count Количество созданных экземпляров (больше 1 для пакета)
+   * @param started Отсчет MonotonicNanos() перед вызовом фабрики
+   */
+  void constructed(size_t count, size_t started) {
+    size_t elapsed = MonotonicNanos() - started;
+    FetchAdd(&constructs, count);
+    FetchAdd(&construct_ns, elapsed);
+    size_t max = LoadAcquire(&max_construct_ns);
+    while (elapsed > max && !CompareExchange(&max_construct_ns, max, elapsed))
+      max = LoadAcquire(&max_construct_ns);
+  }
+
+  /** @brief Согласованное чтение всех счетчиков
+   * @return Копия счетчиков
+   */
+  ServiceCounters snapshot() const {
+    ServiceCounters copy;
+    copy.resolves = LoadAcquire(&resolves);
+    copy.constructs = LoadAcquire(&constructs);
+    copy.construct_ns = LoadAcquire(&construct_ns);
+    copy.max_construct_ns = LoadAcquire(&max_construct_ns);
+    copy.bytes = LoadAcquire(&bytes);
+    copy.failures = LoadAcquire(&failures);
+    return copy;
+  }
+};
+
+/** @brief Снимок счетчиков одной записи реестра
+ */
+struct ServiceStats {
+  const void* type;          // TypeId<T>, TypeId<Keyed<T> > или Named<T>
+  size_t key;                // Значение ServiceKey или 0
+  const char* name;          // Строковый ключ или NULL
+  size_t index;              // Номер записи в порядке регистрации
+  Strategy strategy;         // Стратегия сервиса
+  ServiceCounters counters;  // Значения счетчиков
+};
+#endif
+
+/** @brief Функции доступа к фабрике конкретного типа
+ * @details Вызывают методы фабрики F квалифицированно, т.е. без обращения к
+ * таблице виртуальных функций. Адреса этих функций сохраняются в дескрипторе
+ * при регистрации сервиса.
+ * @tparam F Тип фабрики.
+ */
+template <typename F>
+struct FactoryThunks {
+  static void* create(void* factory, void* buffer) {
+    return static_cast<F*>(factory)->F::create(buffer);
+  }
+
+  static void destroy(void* factory, void* instance) {
+    static_cast<F*>(factory)->F::destroy(instance);
+  }
+
+  static size_t dependencies(const void* factory, void** out) {
+    return static_cast<const F*>(factory)->F::dependencies(out);
+  }
+
+  static void dispose(void* factory) { static_cast<F*>(factory)->F::~F(); }
+};
+
 /** @brief Структура Descriptor для хранения информации о сервисах
  * @details Эта структура используется для хранения информации о сервисах,
- * включая фабрику, стратегию создания, экземпляр и хранилище.
+ * включая фабрику, стратегию создания, экземпляр и хранилище. Фабрика
+ * хранится во встроенном буфере дескриптора вместе с аргументами
+ * конструктора сервиса, а ее методы вызываются через указатели на функции
+ * FactoryThunks, поэтому регистрация не выделяет память под фабрику, а
+ * создание экземпляра не требует виртуального вызова.
  */
 struct Descriptor {
-  IFactory*
-      factory;  // Указатель на фабрику, которая создает экземпляры сервиса
+  /** @brief Состояния создания синглтона
+   */
+  enum State {
+    EMPTY = 0,     // Экземпляр не создан
+    BUILDING = 1,  // Экземпляр создается одним из потоков
+    READY = 2      // Экземпляр создан и опубликован
+  };
+
+  void* (*create_fn)(void*, void*);  // Создание экземпляра фабрикой
+  void (*destroy_fn)(void*, void*);  // Уничтожение экземпляра фабрикой
+  size_t (*dependencies_fn)(const void*, void**);  // Зависимости фабрики
+  void (*dispose_fn)(void*);  // Деструктор фабрики или NULL, если ее нет
+  AlignedStorage<KNOT_FACTORY_INLINE_BYTES> factory;  // Буфер для фабрики
   Strategy strategy;  // Стратегия создания сервиса (SINGLETON или TRANSIENT)
   void* instance;     // Указатель на экземпляр сервиса, если он создан.
                       // Применяется только для SINGLETON
   void* storage;  // Указатель на хранилище, где хранится сервис. Используется
                   // для SINGLETON сервисов
+  size_t storage_size;   // Размер хранилища экземпляра в байтах
+  size_t storage_align;  // Выравнивание хранилища в байтах
+  bool bound;            // Реализация зарегистрирована под интерфейсом
+#if KNOT_INSTRUMENTATION
+  ServiceCounters counters;  // Счетчики разрешений и созданий
+#endif
+  size_t state;          // Состояние создания синглтона (State)
+  size_t owner;  // Идентификатор потока, создающего синглтон, или 0
+  void* waiting;  // Синглтон, которого ждет поток-владелец, или NULL
+  void* recycle_head;     // Список освобожденных блоков временного сервиса
+  size_t recycle_count;   // Количество блоков в списке
+  size_t recycle_limit;   // Максимальное количество блоков в списке
+  size_t recycle_hits;    // Количество созданий из блока списка
+  size_t recycle_misses;  // Количество созданий с выделением памяти из пула
+
+  Descriptor()
+      : create_fn(0),
+        destroy_fn(0),
+        dependencies_fn(0),
+        dispose_fn(0),
+        strategy(),
+        instance(0),
+        storage(0),
+        storage_size(0),
+        storage_align(0),
+        bound(false),
+#if KNOT_INSTRUMENTATION
+        counters(),
+#endif
+        state(EMPTY),
+        owner(0),
+        waiting(NULL),
+        recycle_head(0),
+        recycle_count(0),
+        recycle_limit(KNOT_RECYCLE_LIMIT),
+        recycle_hits(0),
+        recycle_misses(0) {}
 
-  Descriptor() : factory(0), strategy(), instance(0), storage(0) {}
+  ~Descriptor() { resetFactory(); }
+
+  /** @brief Размещение копии фабрики во встроенном буфере
+   * @details Размер фабрики проверяется на этапе компиляции. Если фабрика с
+   * аргументами не помещается, увеличьте KNOT_FACTORY_INLINE_BYTES.
+   * @tparam F Тип фабрики
+   * @param source Фабрика, копия которой будет сохранена
+   */
+  template <typename F>
+  void setFactory(const F& source) {
+    enum {
+      fits = sizeof(CompileCheck<(sizeof(F) <= KNOT_FACTORY_INLINE_BYTES)>)
+    };
+    resetFactory();
+    new (factory.data) F(source);
+    create_fn = &FactoryThunks<F>::create;
+    destroy_fn = &FactoryThunks<F>::destroy;
+    dependencies_fn = &FactoryThunks<F>::dependencies;
+    dispose_fn = &FactoryThunks<F>::dispose;
+  }
+
+  /** @brief Уничтожение фабрики, если она задана
+   */
+  void resetFactory() {
+    if (dispose_fn) dispose_fn(factory.data);
+    create_fn = NULL;
+    destroy_fn = NULL;
+    dependencies_fn = NULL;
+    dispose_fn = NULL;
+  }
+
+  /** @brief Задана ли фабрика
+   * @return true, если сервис создается фабрикой
+   */
+  bool hasFactory() const { return dispose_fn != NULL; }
+
+  /** @brief Создание экземпляра сервиса
+   * @param buffer Память для экземпляра
+   * @return Указатель на созданный экземпляр. Для реализации,
+   * зарегистрированной под интерфейсом, это указатель на интерфейс, который
+   * может не совпадать с buffer.
+   */
+  void* create(void* buffer) { return create_fn(factory.data, buffer); }
+
+  /** @brief Уничтожение экземпляра сервиса без освобождения памяти
+   * @param ptr Память экземпляра, переданная в create()
+   */
+  void destroy(void* ptr) { destroy_fn(factory.data, ptr); }
+
+  /** @brief Получение внедряемых зависимостей сервиса
+   * @param out Массив из IFactory::MAX_DEPENDENCIES элементов
+   * @return Количество записанных идентификаторов типов
+   */
+  size_t dependencies(void** out) const {
+    return dependencies_fn ? dependencies_fn(factory.data, out) : 0;
+  }
 
  private:
   Descriptor& operator=(const Descriptor&);  // Запрет присваивания дескриптора
   Descriptor(const Descriptor&);             // Запрет копирования дескриптора
 };
+
+/** @brief Структура для хранения информации о сервисах в реестре
+ * @details Эта структура используется для хранения информации о сервисах в
+ * реестре, включая указатель на тип сервиса и дескриптор, содержащий информацию
+ * о фабрике, стратегии создания и экземпляре.
+ */
+struct RegistryEntry {
+  void* type;        // Указатель на уникальный идентификатор типа сервиса
+  size_t key;        // Значение ServiceKey или 0 для регистрации без ключа
+  const char* name;  // Копия строкового ключа или NULL
+  size_t index;      // Номер записи в порядке регистрации
+  Descriptor desc;   // Дескриптор, содержащий информацию о сервисе
+};
+
+/** @brief Ячейка хеш-таблицы реестра
+ * @details Идентификатор типа и ключ хранятся рядом с указателем на запись,
+ * поэтому при поиске сравнение не требует перехода к самой записи.
+ */
+struct RegistrySlot {
+  void* type;            // Идентификатор типа или NULL для свободной ячейки
+  size_t key;            // Ключ регистрации
+  RegistryEntry* entry;  // Запись реестра для этой пары
+};
+
+/** @brief Неизменяемая таблица запечатанного реестра
+ * @details Совершенное хеширование по схеме "hash and displace": старшие
+ * биты хеша пары (тип, ключ) выбирают группу, а смещение группы вместе с
+ * хешем - ячейку. Смещения подбираются при запечатывании так, что все пары
+ * попадают в разные ячейки, поэтому поиск - одно сравнение без
+ * пробирования. Таблица строится Container::seal() и после этого не
+ * меняется.
+ */
+struct SealedTable {
+  RegistrySlot* slots;    // Ячейки таблицы
+  size_t slot_count;      // Количество ячеек, степень двойки
+  size_t slot_shift;      // Сдвиг хеша до номера ячейки
+  size_t* displacements;  // Смещения групп
+  size_t group_count;     // Количество групп, степень двойки
+  size_t group_shift;     // Сдвиг хеша до номера группы
+
+  /** @brief Номер ячейки для хеша и смещения группы
+   * @details HashTypeId(NULL, x) - одно фибоначчиево умножение, которое
+   * переносит изменение младших бит смещения в старшие биты номера ячейки.
+   * @param hash Хеш пары (тип, ключ)
+   * @param displacement Смещение группы
+   */
+  size_t slotOf(size_t hash, size_t displacement) const {
+    return HashTypeId(NULL, hash ^ displacement) >> slot_shift;
+  }
+
+  /** @brief Поиск записи
+   * @param tid Идентификатор типа
+   * @param key Значение ключа или 0
+   * @return Запись реестра или NULL
+   */
+  RegistryEntry* find(const void* tid, size_t key) const {
+    if (!slots) return NULL;
+    size_t hash = HashTypeId(tid, key);
+    const RegistrySlot& slot =
+        slots[slotOf(hash, displacements[hash >> group_shift])];
+    return slot.type == tid && slot.key == key ? slot.entry : NULL;
+  }
+};
+
+/** @brief Дескриптор зарегистрированного сервиса
+ * @details Запоминает найденную запись реестра, поэтому повторное
+ * разрешение через Container::resolve(handle) не выполняет поиск.
+ * Действителен, пока жив контейнер, который его выдал.
+ * @tparam T Тип сервиса
+ */
+template <typename T>
+struct ServiceHandle {
+  RegistryEntry* entry;  // Запись реестра или NULL
+
+  ServiceHandle() : entry(NULL) {}
+
+  /** @brief Проверка, что дескриптор ссылается на запись
+   */
+  bool valid() const { return entry != NULL; }
+};
 };  // namespace Knot
 
 #endif  // DESCRIPTOR_HPP
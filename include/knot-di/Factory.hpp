@@ -9,6 +9,7 @@
 #ifndef FACTORY_HPP
 #define FACTORY_HPP
 
+#include <cstddef>
 #include <new>
 
 #include "ContainerMacros.hpp"
@@ -21,11 +22,39 @@ namespace Knot {
  */
 class IFactory {
  public:
+  enum { MAX_DEPENDENCIES = 8 };  // Максимальное число зависимостей фабрики
+
   virtual ~IFactory() {};
+
+  /** @brief Создание экземпляра в заданном буфере
+   * @param buffer Память размера и выравнивания создаваемого типа
+   * @return Указатель на созданный экземпляр
+   */
   virtual void* create(void* buffer) = 0;
   virtual void destroy(void* instance) = 0;
+
+  /** @brief Получение внедряемых зависимостей сервиса
+   * @param out Массив из MAX_DEPENDENCIES элементов для идентификаторов типов
+   * (TypeId) зависимостей.
+   * @return Количество записанных идентификаторов.
+   */
+  virtual size_t dependencies(void** out) const {
+    (void)out;
+    return 0;
+  }
 };
 
+/** @brief Идентификатор зависимости, которую представляет аргумент фабрики
+ * @details Обычные аргументы зависимостями не являются. Для внедряемых
+ * зависимостей (Inject) определена перегрузка, возвращающая TypeId типа
+ * зависимости.
+ * @return NULL
+ */
+template <typename A>
+void* DependencyId(const A&) {
+  return NULL;
+}
+
 /** @brief Фабрика для создания и уничтожения экземпляров сервисов
  * @details Этот шаблонный класс реализует интерфейс IFactory и предоставляет
  * методы для создания и уничтожения экземпляров сервисов. Он может быть
@@ -33,8 +62,8 @@ class IFactory {
  * @tparam T Тип сервиса, который будет создан фабрикой.
  *
  * @note Фабрика использует placement new для создания экземпляров сервисов в
- * заданном буфере. Если буфер не задан, используется стандартный new для
- * создания экземпляра.
+ * заданном буфере. Память выделяет вызывающий код: только он знает
+ * выравнивание, которое требуется типу сверх гарантий operator new.
  *
  * @note Похожие классы генерации фабрик создаются с помощью макроса
  * FACTORY_GEN, который позволяет создавать фабрики с различным количеством
@@ -43,7 +72,7 @@ class IFactory {
 template <typename T>
 class Factory : public IFactory {
  public:
-  void* create(void* buffer) { return buffer ? new (buffer) T() : new T(); }
+  void* create(void* buffer) { return new (buffer) T(); }
   void destroy(void* instance) {
     if (instance) static_cast<T*>(instance)->~T();
   }
@@ -51,6 +80,27 @@ class Factory : public IFactory {
 
 FACTORY_GEN  // Макрос для генерации фабрик с различной арностью
 
+/** @brief Фабрика реализации, зарегистрированной под интерфейсом
+ * @details Создает экземпляр C фабрикой F и возвращает указатель на
+ * подобъект I. Приведение выполняется один раз при создании, поэтому
+ * контейнер хранит уже смещенный указатель на интерфейс, и разрешение не
+ * требует dynamic_cast. Уничтожение получает адрес памяти экземпляра, а не
+ * указатель на интерфейс, и вызывает деструктор C, поэтому корректно и при
+ * множественном наследовании, и без виртуального деструктора у I.
+ * @tparam I Интерфейс, под которым зарегистрирован сервис
+ * @tparam C Реализация, производная от I
+ * @tparam F Фабрика, создающая C
+ */
+template <typename I, typename C, typename F>
+class BoundFactory : public F {
+ public:
+  explicit BoundFactory(const F& factory) : F(factory) {}
+  void* create(void* buffer) {
+    I* instance = static_cast<C*>(F::create(buffer));
+    return instance;
+  }
+};
+
 };  // namespace Knot
 
 #endif  // FACTORY_HPP
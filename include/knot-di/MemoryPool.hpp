@@ -11,37 +11,493 @@
 #define MEMORY_POOL_HPP
 
 #include <cstddef>
-#include <cstdint>
+#include <new>
+#include <stdint.h>
 
 #include "Util.hpp"
+
+#ifndef KNOT_POOL_SIZE_CLASSES
+#define KNOT_POOL_SIZE_CLASSES 8
+#endif
+
+// Размер первого блока (chunk) пула в куче; следующие блоки вдвое больше
+// предыдущего. При значении 0 каждое выделение вызывает operator new.
+#ifndef KNOT_POOL_CHUNK_BYTES
+#define KNOT_POOL_CHUNK_BYTES 65536
+#endif
+
+// Резервирование адресного пространства через mmap (MemoryPool::RESERVE).
+// Доступно на POSIX системах.
+#ifndef KNOT_POOL_MMAP
+#if defined(__unix__) || defined(__APPLE__)
+#define KNOT_POOL_MMAP 1
+#else
+#define KNOT_POOL_MMAP 0
+#endif
+#endif
+
+// Пул в куче с бюджетом не меньше этого значения резервирует весь бюджет
+// через mmap вместо блоков кучи. По умолчанию это пулы от 8 МБ, которым
+// хватает места на несколько больших страниц. При значении 0 выбор делается
+// только явно.
+#ifndef KNOT_POOL_MMAP_BYTES
+#define KNOT_POOL_MMAP_BYTES 8388608
+#endif
+
+// Размер большой страницы: граница выравнивания зарезервированной области
+#ifndef KNOT_POOL_HUGE_PAGE_BYTES
+#define KNOT_POOL_HUGE_PAGE_BYTES 2097152
+#endif
+
+#if KNOT_POOL_MMAP
+#include <sys/mman.h>
+#endif
+
+// Статистика пула (PoolStats): пики, выравнивание, гистограммы размеров и
+// неудач. Нужна для подбора размера буфера; при значении 0 учет не
+// компилируется.
+#ifndef KNOT_POOL_STATS
+#define KNOT_POOL_STATS 0
+#endif
+
+#ifndef KNOT_POOL_STAT_BUCKETS
+#define KNOT_POOL_STAT_BUCKETS 10  // Размерные корзины статистики пула
+#endif
+
+#if KNOT_POOL_STATS
+#define KNOT_POOL_STAT(code) code  // Код учета PoolStats
+#else
+#define KNOT_POOL_STAT(code)  // Учет выключен, код не компилируется
+#endif
+
 namespace Knot {
+#if KNOT_POOL_STATS
+/** @brief Статистика пула памяти
+ * @details Используется для подбора размера буфера пула: peak_offset
+ * показывает, сколько байт буфера было размечено в худший момент, с учетом
+ * выравнивания и фрагментации. Корзина i гистограмм учитывает запросы
+ * размером до MemoryPool::bucketLimit(i) байт включительно; последняя
+ * корзина учитывает все запросы большего размера.
+ */
+struct PoolStats {
+  size_t used_bytes;       // Занятые байты
+  size_t max_bytes;        // Размер пула
+  size_t buffer_offset;    // Текущая вершина буфера
+  size_t high_water;       // Наибольшее значение used_bytes
+  size_t peak_offset;      // Наибольшая вершина буфера
+  size_t padding_bytes;    // Байты, потерянные на выравнивание
+  size_t live_blocks;      // Выделенные и не освобожденные блоки
+  size_t allocations;      // Успешные выделения
+  size_t failures;         // Неудачные выделения
+  size_t largest_failure;  // Размер наибольшего неудачного запроса
+  size_t last_failure;     // Размер последнего неудачного запроса
+
+  // Количество выделений и неудач по размерным корзинам
+  size_t allocation_histogram[KNOT_POOL_STAT_BUCKETS];
+  size_t failure_histogram[KNOT_POOL_STAT_BUCKETS];
+};
+#endif
+
 /** @brief Класс MemoryPool для управления памятью
  *
  * Этот класс предоставляет функциональность для управления памятью с
  * использованием пула памяти. Он позволяет выделять и освобождать память,
  * а также управлять размером пула.
+ *
+ * В режиме буфера освобожденные блоки возвращаются для повторного
+ * использования. Размеры блоков округляются до гранулы (размер FreeBlock).
+ * Небольшие блоки попадают в списки точных размерных классов и выдаются за
+ * O(1). Крупные блоки хранятся в общем списке, упорядоченном по адресу, и
+ * сливаются с соседями. Блок, примыкающий к вершине буфера, возвращается в
+ * неразмеченную область. Если выделить память не удалось, блоки размерных
+ * классов переносятся в общий список со слиянием, и попытка повторяется.
+ *
+ * В режиме кучи с ростом блоками (chunk_bytes != 0) пул запрашивает у
+ * operator new блоки от KNOT_POOL_CHUNK_BYTES байт, каждый следующий вдвое
+ * больше, и размечает их так же, как буфер. Текущий блок играет роль буфера,
+ * а неразмеченный остаток предыдущего блока уходит в свободные блоки.
+ * Бюджет m_max_bytes ограничивает занятые байты; блоки освобождаются целиком
+ * в reset() и в деструкторе.
+ *
+ * В режиме RESERVE пул при первом выделении резервирует через mmap весь
+ * бюджет, выровненный по большой странице, и размечает его как буфер.
+ * Физические страницы выделяются системой при первом обращении; область
+ * помечается MADV_HUGEPAGE, чтобы крупные синглтоны занимали меньше записей
+ * TLB. reset() возвращает страницы системе через MADV_DONTNEED, сохраняя
+ * резерв адресов.
  */
 class MemoryPool {
  private:
+  /** @brief Заголовок свободного блока в режиме буфера
+   * @details Записывается в память самого освобожденного блока, поэтому
+   * занятые блоки не имеют служебных заголовков.
+   */
+  struct FreeBlock {
+    FreeBlock* next;  // Следующий блок в списке
+    size_t size;      // Размер блока в байтах
+  };
+
+  enum { GRANULE = sizeof(FreeBlock) };  // Гранула размера блоков буфера
+
+  /** @brief Заголовок блока памяти, полученного из кучи
+   * @details Размер заголовка равен грануле, поэтому размеченная часть
+   * блока начинается с выравниванием operator new.
+   */
+  struct Chunk {
+    Chunk* prev;  // Предыдущий блок или NULL
+    size_t size;  // Размер размечаемой части в байтах
+  };
+
+  MemoryPool(const MemoryPool&);             // Запрет копирования пула
+  MemoryPool& operator=(const MemoryPool&);  // Запрет присваивания пула
+
   void* m_buffer;  // Указатель на буфер, используемый в качестве пула памяти
+  size_t m_buffer_bytes;  // Размер буфера или текущего блока кучи
+  Chunk* m_chunks;        // Последний блок кучи или NULL
+  size_t m_chunk_bytes;   // Размер следующего блока кучи; 0 - без блоков
 
   size_t m_used_bytes;     // Количество использованных байт в пуле памяти
   size_t m_max_bytes;      // Максимальный размер пула памяти
   size_t m_buffer_offset;  // Смещение в буфере, где начинается следующий
                            // доступный блок памяти
+#if KNOT_POOL_STATS
+  PoolStats m_stats;  // Накопленная статистика; текущие значения
+                      // заполняются в getStats()
+#endif
+
+  FreeBlock* m_classes[KNOT_POOL_SIZE_CLASSES];  // Списки свободных блоков
+                                                 // размером GRANULE * (i + 1)
+  FreeBlock* m_free;  // Общий список свободных блоков, упорядоченный по
+                      // убыванию адреса
+
+#if KNOT_POOL_STATS
+  /** @brief Учет результата выделения
+   * @param size Запрошенный размер в байтах.
+   * @param ptr Выделенный блок или NULL.
+   */
+  void record(size_t size, void* ptr) {
+    size_t bucket = sizeBucket(size);
+    if (!ptr) {
+      ++m_stats.failures;
+      ++m_stats.failure_histogram[bucket];
+      m_stats.last_failure = size;
+      if (size > m_stats.largest_failure) m_stats.largest_failure = size;
+      return;
+    }
+    ++m_stats.allocations;
+    ++m_stats.allocation_histogram[bucket];
+    ++m_stats.live_blocks;
+    if (m_used_bytes > m_stats.high_water) m_stats.high_water = m_used_bytes;
+    if (m_buffer_offset > m_stats.peak_offset)
+      m_stats.peak_offset = m_buffer_offset;
+  }
+#endif
+
+  /** @brief Размер блока буфера для запроса
+   * @details Размер округляется до гранулы, но не выходит за конец буфера.
+   * Блоки кучи и область mmap кратны грануле, поэтому в этих режимах
+   * размер не ограничивается: блок может принадлежать не текущему блоку
+   * кучи.
+   * @param ptr Начало блока.
+   * @param size Запрошенный размер в байтах.
+   * @return Размер блока в байтах.
+   */
+  size_t blockSize(const uint8_t* ptr, size_t size) const {
+    size_t rounded = (size + GRANULE - 1) / GRANULE * GRANULE;
+    if (m_chunk_bytes) return rounded;
+    size_t tail = static_cast<size_t>(end() - ptr);
+    return rounded < tail ? rounded : tail;
+  }
+
+  /** @brief Выравнивание начала буфера по грануле
+   * @details Границы блоков буфера идут с шагом гранулы от его начала,
+   * поэтому отступ для выравнивания оказывается либо нулевым, либо кратным
+   * грануле и возвращается в свободные блоки. Байты до первой границы
+   * гранулы не используются и учитываются как потери на выравнивание.
+   */
+  void alignBuffer() {
+    if (!m_buffer) return;
+    uint8_t* start = static_cast<uint8_t*>(AlignPointer(m_buffer, GRANULE));
+    size_t head = static_cast<size_t>(start - begin());
+    if (head > m_buffer_bytes) head = m_buffer_bytes;
+    m_buffer = begin() + head;
+    m_buffer_bytes -= head;
+    KNOT_POOL_STAT(m_stats.padding_bytes += head);
+  }
+
+  uint8_t* begin() const { return static_cast<uint8_t*>(m_buffer); }
+  uint8_t* end() const { return begin() + m_buffer_bytes; }
+  uint8_t* top() const { return begin() + m_buffer_offset; }
+
+  /** @brief Вставка блока в общий список со слиянием соседей
+   * @details Блок, примыкающий к вершине, возвращается в неразмеченную
+   * область вместе со всеми свободными блоками, которые после этого
+   * оказываются на вершине.
+   * @param ptr Начало блока.
+   * @param size Размер блока в байтах.
+   */
+  void insertFree(uint8_t* ptr, size_t size) {
+    if (ptr + size == top()) {
+      m_buffer_offset = static_cast<size_t>(ptr - begin());
+      while (m_free && reinterpret_cast<uint8_t*>(m_free) + m_free->size ==
+                           top()) {
+        m_buffer_offset -= m_free->size;
+        m_free = m_free->next;
+      }
+      return;
+    }
+    FreeBlock* prev = NULL;     // Блок перед upper в списке
+    FreeBlock* upper = NULL;    // Ближайший свободный блок выше ptr
+    FreeBlock* lower = m_free;  // Ближайший свободный блок ниже ptr
+    while (lower && reinterpret_cast<uint8_t*>(lower) > ptr) {
+      prev = upper;
+      upper = lower;
+      lower = lower->next;
+    }
+    if (upper && ptr + size == reinterpret_cast<uint8_t*>(upper)) {
+      size += upper->size;
+      upper = prev;
+    }
+    FreeBlock** link = upper ? &upper->next : &m_free;
+    if (lower && reinterpret_cast<uint8_t*>(lower) + lower->size == ptr) {
+      lower->size += size;
+      *link = lower;
+      return;
+    }
+    FreeBlock* block = reinterpret_cast<FreeBlock*>(ptr);
+    block->size = size;
+    block->next = lower;
+    *link = block;
+  }
+
+  /** @brief Освобождение блока буфера
+   * @param ptr Начало блока.
+   * @param size Размер блока в байтах.
+   */
+  void releaseBlock(uint8_t* ptr, size_t size) {
+    size_t cls = size / GRANULE - 1;
+    if (ptr + size != top() && size % GRANULE == 0 &&
+        cls < KNOT_POOL_SIZE_CLASSES) {
+      FreeBlock* block = reinterpret_cast<FreeBlock*>(ptr);
+      block->size = size;
+      block->next = m_classes[cls];
+      m_classes[cls] = block;
+      return;
+    }
+    insertFree(ptr, size);
+  }
+
+  /** @brief Перенос блоков размерных классов в общий список
+   * @return true, если был перенесен хотя бы один блок.
+   */
+  bool consolidate() {
+    bool moved = false;
+    for (size_t i = 0; i < KNOT_POOL_SIZE_CLASSES; ++i) {
+      while (m_classes[i]) {
+        FreeBlock* block = m_classes[i];
+        m_classes[i] = block->next;
+        insertFree(reinterpret_cast<uint8_t*>(block), block->size);
+        moved = true;
+      }
+    }
+    return moved;
+  }
+
+  /** @brief Выделение блока из буфера
+   * @details Сначала проверяется список размерного класса, затем общий
+   * список (первый подходящий), затем неразмеченная область над вершиной.
+   * Вершина стоит на границе гранулы, поэтому отступ для выравнивания
+   * кратен грануле и возвращается в свободные блоки, а в занятые байты
+   * учитывается только сам блок, как и при освобождении.
+   * @param size Запрошенный размер в байтах.
+   * @param align Выравнивание в байтах.
+   * @param out_alloc_size Размер учтенного блока.
+   * @return Указатель на выровненный блок или NULL.
+   */
+  void* allocateFromBuffer(size_t size, size_t align, size_t* out_alloc_size) {
+    size_t rounded = (size + GRANULE - 1) / GRANULE * GRANULE;
+    size_t cls = rounded / GRANULE - 1;
+    if (cls < KNOT_POOL_SIZE_CLASSES && m_classes[cls] &&
+        reinterpret_cast<size_t>(m_classes[cls]) % align == 0) {
+      FreeBlock* block = m_classes[cls];
+      m_classes[cls] = block->next;
+      m_used_bytes += rounded;
+      if (out_alloc_size) *out_alloc_size = rounded;
+      return block;
+    }
+
+    for (FreeBlock** link = &m_free; *link; link = &(*link)->next) {
+      uint8_t* start = reinterpret_cast<uint8_t*>(*link);
+      size_t block_size = (*link)->size;
+      uint8_t* ptr = static_cast<uint8_t*>(AlignPointer(start, align));
+      size_t pad = static_cast<size_t>(ptr - start);
+      if (pad % GRANULE != 0 || pad + rounded > block_size) continue;
+      *link = (*link)->next;
+      size_t tail = block_size - pad - rounded;
+      if (tail > 0) insertFree(ptr + rounded, tail);
+      if (pad > 0) insertFree(start, pad);
+      m_used_bytes += rounded;
+      if (out_alloc_size) *out_alloc_size = rounded;
+      return ptr;
+    }
+
+    uint8_t* base = top();
+    uint8_t* ptr = static_cast<uint8_t*>(AlignPointer(base, align));
+    size_t pad = static_cast<size_t>(ptr - base);
+    if (pad > static_cast<size_t>(end() - base) ||
+        size > static_cast<size_t>(end() - ptr))
+      return NULL;
+    size_t block = blockSize(ptr, size);
+    m_buffer_offset += pad + block;
+    if (pad > 0) releaseBlock(base, pad);
+    m_used_bytes += block;
+    if (out_alloc_size) *out_alloc_size = block;
+    return ptr;
+  }
+
+  /** @brief Получение нового блока кучи
+   * @details Блок не меньше запроса с учетом выравнивания. Пока блоки
+   * меньше бюджета, каждый следующий вдвое больше предыдущего, поэтому
+   * пул с маленьким бюджетом не резервирует лишнего.
+   * @param size Запрошенный размер в байтах.
+   * @param align Выравнивание в байтах.
+   * @return true, если блок получен и стал текущим.
+   */
+  bool addChunk(size_t size, size_t align) {
+#if KNOT_POOL_MMAP
+    if (m_chunk_bytes == RESERVE) return !m_buffer && mapBudget();
+#endif
+    size_t need = (size + GRANULE - 1) / GRANULE * GRANULE;
+    if (align > GRANULE) need += align;
+    size_t budget = (m_max_bytes + GRANULE - 1) / GRANULE * GRANULE;
+    // Размер блока кратен грануле: блоки в его конце не усекаются, и их
+    // размер не зависит от того, какой блок кучи текущий.
+    size_t grow = m_chunk_bytes < budget
+                      ? (m_chunk_bytes + GRANULE - 1) / GRANULE * GRANULE
+                      : budget;
+    size_t bytes = grow < need ? need : grow;
+    Chunk* chunk = static_cast<Chunk*>(
+        operator new(sizeof(Chunk) + bytes, std::nothrow));
+    if (!chunk) return false;
+    if (m_buffer && top() != end())
+      releaseBlock(top(), static_cast<size_t>(end() - top()));
+    chunk->prev = m_chunks;
+    chunk->size = bytes;
+    m_chunks = chunk;
+    m_buffer = chunk + 1;
+    m_buffer_bytes = bytes;
+    m_buffer_offset = 0;
+    if (m_chunk_bytes < budget) m_chunk_bytes = grow * 2;
+    return true;
+  }
+
+#if KNOT_POOL_MMAP
+  /** @brief Резервирование бюджета через mmap
+   * @details Резервируется на большую страницу больше, и лишнее по краям
+   * возвращается, чтобы область начиналась на границе большой страницы.
+   * MAP_NORESERVE не учитывает резерв как занятую память.
+   * @return true, если область зарезервирована и стала буфером.
+   */
+  bool mapBudget() {
+    size_t huge = KNOT_POOL_HUGE_PAGE_BYTES;
+    size_t bytes = (m_max_bytes + huge - 1) / huge * huge;
+    if (bytes < m_max_bytes || bytes + huge < bytes) return false;
+    size_t span = bytes + huge;
+    void* raw = mmap(NULL, span, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (raw == MAP_FAILED) return false;
+    uint8_t* base = static_cast<uint8_t*>(AlignPointer(raw, huge));
+    size_t head = static_cast<size_t>(base - static_cast<uint8_t*>(raw));
+    if (head) munmap(raw, head);
+    if (span - head > bytes) munmap(base + bytes, span - head - bytes);
+#ifdef MADV_HUGEPAGE
+    madvise(base, bytes, MADV_HUGEPAGE);
+#endif
+    m_buffer = base;
+    m_buffer_bytes = bytes;
+    m_buffer_offset = 0;
+    return true;
+  }
+#endif
+
+  /** @brief Освобождение всех блоков кучи
+   * @details В режиме RESERVE освобождает и резерв адресов.
+   */
+  void releaseChunks() {
+#if KNOT_POOL_MMAP
+    if (m_chunk_bytes == RESERVE && m_buffer) {
+      munmap(m_buffer, m_buffer_bytes);
+      m_buffer = NULL;
+      m_buffer_bytes = 0;
+    }
+#endif
+    while (m_chunks) {
+      Chunk* prev = m_chunks->prev;
+      operator delete(m_chunks);
+      m_chunks = prev;
+    }
+  }
 
  public:
+#if KNOT_POOL_MMAP
+  // Значение chunk_bytes: весь бюджет резервируется одной областью mmap
+  static const size_t RESERVE = static_cast<size_t>(-1);
+#endif
+
+  /** @brief Размер первого блока кучи по умолчанию
+   * @param max_bytes Бюджет пула в байтах.
+   * @return RESERVE для пулов от KNOT_POOL_MMAP_BYTES байт, иначе
+   * KNOT_POOL_CHUNK_BYTES.
+   */
+  static size_t defaultChunkBytes(size_t max_bytes) {
+#if KNOT_POOL_MMAP && KNOT_POOL_MMAP_BYTES
+    if (max_bytes >= KNOT_POOL_MMAP_BYTES) return RESERVE;
+#endif
+    (void)max_bytes;
+    return KNOT_POOL_CHUNK_BYTES;
+  }
+
   /** @brief Конструктор MemoryPool без параметров
    * @details Создает пул памяти с максимальным размером,
-   * заданным в параметре max_bytes.
+   * заданным в параметре max_bytes. Память берется из блоков кучи или, для
+   * пулов от KNOT_POOL_MMAP_BYTES байт, из области mmap.
    *
    * @param max_bytes Максимальный размер пула памяти в байтах.
    */
   MemoryPool(size_t max_bytes)
       : m_buffer(NULL),
+        m_buffer_bytes(0),
+        m_chunks(NULL),
+        m_chunk_bytes(defaultChunkBytes(max_bytes)),
         m_used_bytes(0),
         m_max_bytes(max_bytes),
-        m_buffer_offset(0) {}
+        m_buffer_offset(0),
+#if KNOT_POOL_STATS
+        m_stats(),
+#endif
+        m_classes(),
+        m_free(NULL) {}
+
+  /** @brief Конструктор MemoryPool с выбором способа роста
+   * @param max_bytes Максимальный размер пула памяти в байтах.
+   * @param chunk_bytes Размер первого блока кучи в байтах. При значении 0
+   * каждое выделение вызывает operator new, а выравнивание сверх
+   * гарантированного operator new не соблюдается. RESERVE резервирует весь
+   * бюджет через mmap.
+   */
+  MemoryPool(size_t max_bytes, size_t chunk_bytes)
+      : m_buffer(NULL),
+        m_buffer_bytes(0),
+        m_chunks(NULL),
+        m_chunk_bytes(chunk_bytes),
+        m_used_bytes(0),
+        m_max_bytes(max_bytes),
+        m_buffer_offset(0),
+#if KNOT_POOL_STATS
+        m_stats(),
+#endif
+        m_classes(),
+        m_free(NULL) {}
 
   /** @brief Конструктор MemoryPool с указанием буфера и его размера
    * @details Создает пул памяти с заданным буфером и его размером.
@@ -51,7 +507,20 @@ class MemoryPool {
    */
   template <size_t N>
   MemoryPool(uint8_t (&buffer)[N])
-      : m_buffer(buffer), m_used_bytes(0), m_max_bytes(N), m_buffer_offset(0) {}
+      : m_buffer(buffer),
+        m_buffer_bytes(N),
+        m_chunks(NULL),
+        m_chunk_bytes(0),
+        m_used_bytes(0),
+        m_max_bytes(N),
+        m_buffer_offset(0),
+#if KNOT_POOL_STATS
+        m_stats(),
+#endif
+        m_classes(),
+        m_free(NULL) {
+    alignBuffer();
+  }
 
   /** @brief Конструктор MemoryPool с указанием буфера и типа. Размер
    * вычисляется автоматически.
@@ -65,14 +534,55 @@ class MemoryPool {
   template <typename T, size_t N>
   MemoryPool(T (&buffer)[N])
       : m_buffer(static_cast<void*>(buffer)),
+        m_buffer_bytes(sizeof(T) * N),
+        m_chunks(NULL),
+        m_chunk_bytes(0),
         m_used_bytes(0),
         m_max_bytes(sizeof(T) * N),
-        m_buffer_offset(0) {}
+        m_buffer_offset(0),
+#if KNOT_POOL_STATS
+        m_stats(),
+#endif
+        m_classes(),
+        m_free(NULL) {
+    alignBuffer();
+  }
+
+  /** @brief Конструктор MemoryPool над произвольной областью памяти
+   * @details Создает пул памяти в режиме буфера над областью, заданной
+   * указателем и размером. Используется, например, для арен, выделенных из
+   * другого пула.
+   *
+   * @param buffer Указатель на начало области или NULL. Если область не
+   * задана, пул не сможет выделить ни одного байта.
+   * @param size Размер области в байтах.
+   */
+  MemoryPool(void* buffer, size_t size)
+      : m_buffer(buffer),
+        m_buffer_bytes(buffer ? size : 0),
+        m_chunks(NULL),
+        m_chunk_bytes(0),
+        m_used_bytes(0),
+        m_max_bytes(buffer ? size : 0),
+        m_buffer_offset(0),
+#if KNOT_POOL_STATS
+        m_stats(),
+#endif
+        m_classes(),
+        m_free(NULL) {
+    alignBuffer();
+  }
+
+  /** @brief Деструктор MemoryPool
+   * @details Возвращает в кучу блоки, полученные в режиме роста блоками.
+   */
+  ~MemoryPool() { releaseChunks(); }
 
   /** @brief Метод для выделения памяти из пула
    * @details Этот метод выделяет память из пула с учетом выравнивания и
    * возвращает указатель на выделенный блок памяти. Если буфер не задан,
-   * используется стандартный оператор new для выделения памяти.
+   * память размечается в блоках кучи, а при chunk_bytes == 0 каждое
+   * выделение вызывает стандартный оператор new.
    * @param size Размер блока памяти, который нужно выделить, в байтах.
    * @param align Выравнивание для выделения памяти, в байтах.
    * @param out_alloc_size Указатель на переменную, в которую будет записан
@@ -81,34 +591,38 @@ class MemoryPool {
    */
   void* allocateRaw(size_t size, size_t align, size_t* out_alloc_size = 0) {
     if (size == 0) return NULL;
-    if (m_buffer) {
-      uint8_t* base = static_cast<uint8_t*>(m_buffer) + m_buffer_offset;
-      size_t space = m_max_bytes - m_buffer_offset;
-      size_t misalign = reinterpret_cast<size_t>(base) % align;
-      size_t pad = misalign ? (align - misalign) : 0;
-
-      if (size + pad > space) return NULL;
-
-      void* ptr = reinterpret_cast<void*>(base + pad);
-      if (out_alloc_size) *out_alloc_size = size + pad;
-      m_buffer_offset += size + pad;
-      m_used_bytes += size + pad;
+    if (m_buffer || m_chunk_bytes) {
+      void* ptr = NULL;
+      // Блоки кучи ограничены бюджетом, буфер - своим размером
+      if (!m_chunk_bytes || m_used_bytes + size <= m_max_bytes) {
+        if (m_buffer) ptr = allocateFromBuffer(size, align, out_alloc_size);
+        if (!ptr && consolidate())
+          ptr = allocateFromBuffer(size, align, out_alloc_size);
+        if (!ptr && m_chunk_bytes && addChunk(size, align))
+          ptr = allocateFromBuffer(size, align, out_alloc_size);
+      }
+      KNOT_POOL_STAT(record(size, ptr));
       return ptr;
     } else {
-      if (m_used_bytes + size > m_max_bytes || size == 0) return NULL;
+      if (m_used_bytes + size > m_max_bytes || size == 0) {
+        KNOT_POOL_STAT(record(size, NULL));
+        return NULL;
+      }
       void* ptr = reinterpret_cast<void*>(operator new(size));
       if (ptr) {
         if (out_alloc_size) *out_alloc_size = size;
         m_used_bytes += size;
+        KNOT_POOL_STAT(record(size, ptr));
         return ptr;
       }
+      KNOT_POOL_STAT(record(size, NULL));
       return NULL;
     }
   }
 
   template <typename T>
   void* allocate(size_t count = 1) {
-    using Elem = typename ElementType<T>::Type;
+    typedef typename ElementType<T>::Type Elem;
     return allocateRaw(sizeof(Elem) * count, AlignmentOf<Elem>::value);
   }
   /** @brief Метод для освобождения памяти в пуле
@@ -118,9 +632,9 @@ class MemoryPool {
    * @param ptr Указатель на блок памяти, который нужно освободить.
    * @param size Размер блока памяти, который нужно освободить, в байтах.
    *
-   * @note При наличии буфера, метод просто возвращает, так как
-   * освобождение памяти не требуется из-за отсутствия индивидуального
-   * распределения в режиме арены/буфера.
+   * @note При наличии буфера блок возвращается в списки свободных блоков и
+   * может быть выдан повторно. Размер должен совпадать с размером,
+   * запрошенным при выделении.
    *
    * @warning Этот метод не проверяет, был ли указатель ptr ранее выделен
    * из пула памяти. Освобождение памяти, которая не была выделена из пула,
@@ -128,10 +642,18 @@ class MemoryPool {
    */
   void deallocate(void* ptr, size_t size) {
     if (m_buffer != NULL) {
+      if (!ptr || size == 0) return;
+      uint8_t* block = static_cast<uint8_t*>(ptr);
+      size_t block_size = blockSize(block, size);
+      m_used_bytes =
+          m_used_bytes < block_size ? 0 : m_used_bytes - block_size;
+      KNOT_POOL_STAT(if (m_stats.live_blocks) --m_stats.live_blocks);
+      releaseBlock(block, block_size);
       return;
     }
     if (ptr) {
       operator delete(ptr);
+      KNOT_POOL_STAT(if (m_stats.live_blocks) --m_stats.live_blocks);
       if (m_used_bytes < size) {
         m_used_bytes = 0;
       } else {
@@ -154,14 +676,52 @@ class MemoryPool {
    * @return Максимальный размер пула памяти в байтах.
    */
   size_t getMaxBytes() const { return m_max_bytes; }
+
+  /** @brief Сброс пула памяти
+   * @details В режиме буфера отбрасывает все выделенные и свободные блоки и
+   * возвращает вершину в начало буфера. В режиме роста блоками возвращает
+   * блоки в кучу; следующий блок сохраняет достигнутый размер. В режиме
+   * RESERVE возвращает системе страницы области, сохраняя резерв адресов.
+   */
   void reset() {
     m_used_bytes = 0;
     m_buffer_offset = 0;
+    KNOT_POOL_STAT(m_stats.live_blocks = 0);
+    for (size_t i = 0; i < KNOT_POOL_SIZE_CLASSES; ++i) m_classes[i] = NULL;
+    m_free = NULL;
+#if KNOT_POOL_MMAP
+    if (m_chunk_bytes == RESERVE && m_buffer) {
+      madvise(m_buffer, m_buffer_bytes, MADV_DONTNEED);
+      return;
+    }
+#endif
+    if (m_chunks) {
+      releaseChunks();
+      m_buffer = NULL;
+      m_buffer_bytes = 0;
+    }
+  }
+
+  /** @brief Сброс пула с переходом на новую область памяти
+   * @details Пул переходит в режим буфера над заданной областью, как после
+   * конструктора MemoryPool(buffer, size). Накопленная статистика
+   * сохраняется.
+   * @param buffer Указатель на начало области или NULL.
+   * @param size Размер области в байтах.
+   */
+  void reset(void* buffer, size_t size) {
+    releaseChunks();
+    reset();
+    m_buffer = buffer;
+    m_buffer_bytes = buffer ? size : 0;
+    m_max_bytes = m_buffer_bytes;
+    m_chunk_bytes = 0;
   }
 
   /** @brief Получение указателя на буфер пула памяти
    * @details Этот метод возвращает указатель на буфер, который используется
-   * в качестве пула памяти. Если буфер не задан, возвращается nullptr.
+   * в качестве пула памяти. Если буфер не задан, возвращается nullptr, а в
+   * режиме роста блоками - текущий блок кучи.
    * @return Указатель на буфер пула памяти или nullptr, если буфер не задан.
    */
   void* getBuffer() const { return m_buffer; }
@@ -174,6 +734,55 @@ class MemoryPool {
    * @return Смещение в буфере, где начинается следующий доступный блок памяти.
    */
   size_t getBufferOffset() const { return m_buffer_offset; }
+
+#if KNOT_POOL_STATS
+  /** @brief Получение статистики пула памяти
+   * @details Накопленные значения (пики, счетчики, гистограммы) переживают
+   * reset(), поэтому после прогона рабочей нагрузки peak_offset дает
+   * необходимый размер буфера.
+   * @return Снимок статистики.
+   */
+  PoolStats getStats() const {
+    PoolStats stats = m_stats;
+    stats.used_bytes = m_used_bytes;
+    stats.max_bytes = m_max_bytes;
+    stats.buffer_offset = m_buffer_offset;
+    return stats;
+  }
+
+  /** @brief Сброс накопленной статистики
+   * @details Пики становятся равными текущему состоянию пула, счетчики и
+   * гистограммы обнуляются. Количество живых блоков сохраняется.
+   */
+  void resetStats() {
+    size_t live = m_stats.live_blocks;
+    m_stats = PoolStats();
+    m_stats.live_blocks = live;
+    m_stats.high_water = m_used_bytes;
+    m_stats.peak_offset = m_buffer_offset;
+  }
+
+  /** @brief Номер корзины гистограммы для размера запроса
+   * @param size Размер запроса в байтах.
+   * @return Номер корзины от 0 до KNOT_POOL_STAT_BUCKETS - 1.
+   */
+  static size_t sizeBucket(size_t size) {
+    size_t bucket = 0;
+    while (bucket + 1 < KNOT_POOL_STAT_BUCKETS && size > bucketLimit(bucket))
+      ++bucket;
+    return bucket;
+  }
+
+  /** @brief Верхняя граница корзины гистограммы
+   * @param bucket Номер корзины.
+   * @return Наибольший размер запроса, попадающий в корзину, в байтах:
+   * GRANULE, 2 * GRANULE, 4 * GRANULE и т.д. Последняя корзина не
+   * ограничена сверху.
+   */
+  static size_t bucketLimit(size_t bucket) {
+    return static_cast<size_t>(GRANULE) << bucket;
+  }
+#endif
 };
 }  // namespace Knot
 
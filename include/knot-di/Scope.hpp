@@ -0,0 +1,281 @@
+/** @file Scope.hpp
+ * @brief Заголовочный файл для класса Scope. Класс предназначен для
+ * управления сервисами со стратегией SCOPED.
+ * @version 1.0
+ *
+ * Этот файл содержит определение класса Scope, который хранит по одному
+ * экземпляру каждого SCOPED сервиса контейнера. Экземпляры размещаются в
+ * собственной арене, выделенной из пула памяти контейнера, и освобождаются
+ * все сразу при завершении области видимости.
+ */
+#ifndef SCOPE_HPP
+#define SCOPE_HPP
+
+#include <cstddef>
+#include <cstring>
+
+#include "Container.hpp"
+#include "MemoryPool.hpp"
+#include "Util.hpp"
+
+#ifndef KNOT_SCOPE_ARENA_BYTES
+#define KNOT_SCOPE_ARENA_BYTES 1024
+#endif
+
+namespace Knot {
+/** @brief Структура для хранения информации о созданных SCOPED сервисах
+ * @details Записи хранятся в порядке создания, что позволяет уничтожать
+ * экземпляры в обратном порядке.
+ */
+struct ScopedInfo {
+  void* ptr;         // Память экземпляра сервиса в арене
+  Descriptor* desc;  // Дескриптор сервиса, фабрика которого создала экземпляр
+  size_t slot;       // Номер записи сервиса в реестре контейнера
+};
+
+/** @brief Область видимости для сервисов со стратегией SCOPED
+ *
+ * Область видимости создается из контейнера и кэширует по одному экземпляру
+ * каждого SCOPED сервиса. Память для экземпляров выделяется из арены, которую
+ * область видимости получает из пула контейнера при создании. Метод end()
+ * вызывает деструкторы созданных экземпляров в обратном порядке и
+ * возвращает арену в исходное состояние одним действием, после чего область
+ * видимости можно использовать повторно.
+ *
+ * @code
+ * Knot::Scope scope(container);
+ * Session* s = scope.resolve<Session>();
+ * scope.end();
+ * @endcode
+ *
+ * @warning Область видимости должна быть уничтожена раньше контейнера.
+ */
+class Scope {
+ private:
+  Scope(const Scope&);             // Запрет копирования области видимости
+  Scope& operator=(const Scope&);  // Запрет присваивания области видимости
+
+  Container& m_container;  // Контейнер, из которого создана область
+  void* m_region;          // Область памяти арены в пуле контейнера
+  size_t m_region_size;    // Размер области памяти арены
+  MemoryPool m_arena;      // Арена для экземпляров SCOPED сервисов
+
+  size_t m_created_count;  // Количество созданных экземпляров
+#if KNOT_DYNAMIC_REGISTRY
+  size_t m_capacity;      // Емкость массивов m_created и m_instances
+  ScopedInfo* m_created;  // Созданные экземпляры в порядке создания
+  void** m_instances;     // Экземпляры по номеру записи реестра
+
+  /** @brief метод для увеличения массивов области видимости
+   * @details Массивы выделяются из пула контейнера и растут вместе с
+   * реестром, поэтому область видимости обслуживает сервисы,
+   * зарегистрированные и после ее создания.
+   * @param slot Номер записи реестра, для которой нужно место
+   * @return true, если место есть
+   */
+  bool reserve_slot(size_t slot) {
+    if (slot < m_capacity) return true;
+    size_t capacity = m_capacity ? m_capacity * 2 : KNOT_MAX_SERVICES;
+    if (capacity <= slot) capacity = slot + 1;
+    void* created = m_container.allocate_region(sizeof(ScopedInfo) * capacity);
+    if (!created) return false;
+    void* instances = m_container.allocate_region(sizeof(void*) * capacity);
+    if (!instances) {
+      m_container.release_region(created, sizeof(ScopedInfo) * capacity);
+      return false;
+    }
+    std::memset(instances, 0, sizeof(void*) * capacity);
+    if (m_capacity) {
+      std::memcpy(created, m_created, sizeof(ScopedInfo) * m_created_count);
+      std::memcpy(instances, m_instances, sizeof(void*) * m_capacity);
+      release_slots();
+    }
+    m_created = static_cast<ScopedInfo*>(created);
+    m_instances = static_cast<void**>(instances);
+    m_capacity = capacity;
+    return true;
+  }
+
+  /** @brief метод для возврата массивов области видимости в пул
+   */
+  void release_slots() {
+    if (!m_capacity) return;
+    m_container.release_region(m_created, sizeof(ScopedInfo) * m_capacity);
+    m_container.release_region(m_instances, sizeof(void*) * m_capacity);
+  }
+#else
+  ScopedInfo m_created[KNOT_MAX_SERVICES];  // Созданные экземпляры в порядке
+                                            // создания
+  void* m_instances[KNOT_MAX_SERVICES];  // Экземпляры по номеру записи реестра
+
+  /** @brief Массивы фиксированы по числу записей реестра
+   * @details Номера записей дочернего контейнера продолжают номера
+   * родителя, поэтому могут выйти за KNOT_MAX_SERVICES.
+   */
+  bool reserve_slot(size_t slot) { return slot < KNOT_MAX_SERVICES; }
+
+  void release_slots() {}
+#endif
+
+  /** @brief Делает область видимости активной на время разрешения
+   * @details SCOPED зависимости, которые фабрика разрешает через контейнер,
+   * попадают в активную область. При выходе восстанавливается предыдущая
+   * активная область, поэтому вложенные области не мешают друг другу.
+   */
+  class Activation {
+   private:
+    Activation(const Activation&);
+    Activation& operator=(const Activation&);
+
+    ActiveScope m_saved;  // Область, активная до входа
+
+   public:
+    explicit Activation(Scope* scope) : m_saved(CurrentScope()) {
+      CurrentScope().scope = scope;
+      CurrentScope().resolve = &Scope::resolve_active;
+    }
+
+    ~Activation() { CurrentScope() = m_saved; }
+  };
+
+  /** @brief Разрешение SCOPED записи в активной области видимости
+   * @details Вызывается контейнером через ActiveScope::resolve.
+   */
+  static void* resolve_active(void* scope, RegistryEntry* entry) {
+    return static_cast<Scope*>(scope)->resolve_scoped(*entry);
+  }
+
+  /** @brief метод для разрешения сервиса по найденной записи реестра
+   * @tparam T Тип сервиса
+   * @param entry Запись реестра или NULL
+   * @return Указатель на сервис или NULL
+   */
+  template <typename T>
+  T* resolve_entry(RegistryEntry* entry) {
+    if (!entry) return NULL;
+    Activation active(this);
+    if (entry->desc.strategy != SCOPED)
+      return m_container.resolve_entry<T>(entry);
+    return static_cast<T*>(resolve_scoped(*entry));
+  }
+
+  /** @brief метод для получения или создания экземпляра SCOPED сервиса
+   * @param entry Запись реестра со стратегией SCOPED
+   * @return Указатель на экземпляр или NULL
+   */
+  void* resolve_scoped(RegistryEntry& entry) {
+    KNOT_INSTRUMENT(entry.desc.counters.resolved());
+    size_t slot = entry.index;
+    if (!reserve_slot(slot)) {
+      KNOT_INSTRUMENT(entry.desc.counters.failed());
+      return NULL;
+    }
+    if (m_instances[slot]) return m_instances[slot];
+    ResolveGuard resolving(entry.desc);
+    if (!resolving.entered()) {
+      KNOT_INSTRUMENT(entry.desc.counters.failed());
+      return NULL;
+    }
+    Descriptor& desc = entry.desc;
+    void* mem = m_arena.allocateRaw(desc.storage_size, desc.storage_align);
+    if (!mem) {
+      KNOT_INSTRUMENT(desc.counters.failed());
+      return NULL;
+    }
+    KNOT_INSTRUMENT(desc.counters.allocated(desc.storage_size));
+    KNOT_INSTRUMENT(size_t started = MonotonicNanos());
+    void* ptr = desc.create(mem);
+    KNOT_INSTRUMENT(desc.counters.constructed(1, started));
+    if (resolving.dependencyFailed()) {
+      desc.destroy(mem);
+      KNOT_INSTRUMENT(desc.counters.failed());
+      return NULL;
+    }
+    ScopedInfo& info = m_created[m_created_count++];
+    info.ptr = mem;
+    info.desc = &desc;
+    info.slot = slot;
+    m_instances[slot] = ptr;
+    return ptr;
+  }
+
+ public:
+  /** @brief Конструктор области видимости
+   * @param container Контейнер, сервисы которого разрешает область.
+   * @param arena_bytes Размер арены для экземпляров, в байтах.
+   *
+   * @note Если пул контейнера не может выделить арену, область видимости
+   * остается рабочей для не-SCOPED сервисов, а SCOPED сервисы разрешаются в
+   * NULL.
+   */
+  explicit Scope(Container& container,
+                 size_t arena_bytes = KNOT_SCOPE_ARENA_BYTES)
+      : m_container(container),
+        m_region(container.allocate_region(arena_bytes)),
+        m_region_size(arena_bytes),
+        m_arena(m_region, arena_bytes),
+        m_created_count(0),
+#if KNOT_DYNAMIC_REGISTRY
+        m_capacity(0),
+        m_created(NULL),
+#endif
+        m_instances() {
+  }
+
+  /** @brief Деструктор области видимости
+   * @details Уничтожает созданные экземпляры и возвращает арену в пул
+   * контейнера.
+   */
+  ~Scope() {
+    end();
+    if (m_region) m_container.release_region(m_region, m_region_size);
+    release_slots();
+  }
+
+  /** @brief Получение сервиса в пределах области видимости
+   * @details SCOPED сервис создается при первом обращении и кэшируется до
+   * вызова end(). Сервисы с другими стратегиями разрешаются контейнером.
+   * SCOPED зависимости, внедренные через inject(), берутся из этой же
+   * области видимости; синглтону они не внедряются.
+   * @tparam T Тип сервиса
+   * @return Указатель на сервис или NULL, если сервис не зарегистрирован или
+   * не может быть создан.
+   */
+  template <typename T>
+  T* resolve() {
+    return resolve_entry<T>(m_container.find_entry<T>());
+  }
+
+  /** @brief Получение сервиса, зарегистрированного с ключом
+   * @details Работает как resolve(), но ищет регистрацию T под ключом key.
+   * @tparam T Тип сервиса
+   * @param key Ключ регистрации
+   * @return Указатель на сервис или NULL
+   */
+  template <typename T>
+  T* resolve(const ServiceKey& key) {
+    return resolve_entry<T>(m_container.find_keyed<T>(key));
+  }
+
+  /** @brief Завершение области видимости
+   * @details Вызывает деструкторы всех созданных экземпляров в порядке,
+   * обратном порядку создания, и сбрасывает арену. Стоимость пропорциональна
+   * количеству созданных экземпляров.
+   */
+  void end() {
+    while (m_created_count > 0) {
+      ScopedInfo& info = m_created[--m_created_count];
+      info.desc->destroy(info.ptr);
+      m_instances[info.slot] = NULL;
+    }
+    m_arena.reset();
+  }
+
+  /** @brief Получение арены области видимости
+   * @return Ссылка на пул памяти, из которого выделяются экземпляры.
+   */
+  const MemoryPool& getArena() const { return m_arena; }
+};
+};  // namespace Knot
+
+#endif  // SCOPE_HPP
@@ -0,0 +1,383 @@
+/** @file StaticContainer.hpp
+ * @brief Заголовочный файл для класса StaticContainer. Класс предназначен для
+ * разрешения сервисов, набор которых полностью известен на этапе компиляции.
+ * @version 1.0
+ *
+ * Этот файл содержит определение класса StaticContainer и вспомогательных
+ * шаблонов. Набор сервисов и их стратегии задаются списком типов, поэтому
+ * поиск сервиса выполняется компилятором, а каждый сервис получает собственный
+ * слот внутри объекта контейнера.
+ */
+#ifndef STATIC_CONTAINER_HPP
+#define STATIC_CONTAINER_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+
+#include "ContainerMacros.hpp"
+#include "Factory.hpp"
+#include "Strategy.hpp"
+#include "TypeList.hpp"
+#include "Util.hpp"
+
+// Количество одновременно живых экземпляров временного сервиса статического
+// контейнера по умолчанию
+#ifndef KNOT_STATIC_TRANSIENTS
+#define KNOT_STATIC_TRANSIENTS 8
+#endif
+
+namespace Knot {
+/** @brief Описание сервиса статического контейнера
+ * @details Используется как элемент списка типов StaticContainer.
+ * @tparam T Тип сервиса.
+ * @tparam S Стратегия создания сервиса (SINGLETON, TRANSIENT или EXTERNAL).
+ * @tparam F Тип фабрики, создающей сервис. По умолчанию Factory<T>.
+ * @tparam N Для TRANSIENT - сколько экземпляров могут быть живы
+ * одновременно. Для остальных стратегий не используется.
+ */
+template <typename T, Strategy S = SINGLETON, typename F = Factory<T>,
+          size_t N = KNOT_STATIC_TRANSIENTS>
+struct Service {
+  typedef T Type;         // Тип сервиса
+  typedef F FactoryType;  // Тип фабрики сервиса
+};
+
+/** @brief Поиск описания сервиса в списке по типу сервиса
+ * @details Если тип не найден, специализация для NullType не определена, и
+ * обращение к такому сервису приводит к ошибке компиляции.
+ * @tparam L Цепочка узлов списка типов.
+ * @tparam T Тип сервиса.
+ */
+template <typename L, typename T>
+struct FindService;
+
+template <typename S, typename Tail, typename T>
+struct FindService<TypeNode<S, Tail>, T> {
+  typedef typename FindService<Tail, T>::Result Result;
+};
+
+template <typename T, Strategy S, typename F, size_t N, typename Tail>
+struct FindService<TypeNode<Service<T, S, F, N>, Tail>, T> {
+  typedef Service<T, S, F, N> Result;
+};
+
+/** @brief Создание фабрики по умолчанию
+ * @details Фабрики с аргументами нельзя создать без параметров, поэтому для
+ * них слот остается ненастроенным до вызова configure.
+ * @tparam F Тип фабрики.
+ */
+template <typename F>
+struct DefaultFactory {
+  static F* create(void*) { return NULL; }
+};
+
+template <typename T>
+struct DefaultFactory<Factory<T> > {
+  static Factory<T>* create(void* mem) { return new (mem) Factory<T>(); }
+};
+
+/** @brief Хранилище фабрики внутри слота сервиса
+ * @details Фабрика размещается во встроенном буфере слота, поэтому ее методы
+ * вызываются напрямую, без выделения памяти и виртуального вызова.
+ * @tparam F Тип фабрики.
+ */
+template <typename F>
+class StaticFactorySlot {
+ private:
+  StaticFactorySlot(const StaticFactorySlot&);
+  StaticFactorySlot& operator=(const StaticFactorySlot&);
+
+ protected:
+  AlignedStorage<sizeof(F)> m_factory_storage;  // Буфер для фабрики
+  F* m_factory;  // Указатель на фабрику или NULL, если она не настроена
+
+  StaticFactorySlot()
+      : m_factory(DefaultFactory<F>::create(m_factory_storage.data)) {}
+
+  ~StaticFactorySlot() {
+    if (m_factory) m_factory->~F();
+  }
+
+  /** @brief Замена фабрики слота
+   * @param factory Фабрика, копия которой будет сохранена в слоте.
+   */
+  void setFactory(const F& factory) {
+    if (m_factory) m_factory->~F();
+    m_factory = new (m_factory_storage.data) F(factory);
+  }
+};
+
+/** @brief Слот сервиса статического контейнера
+ * @details Специализации определяют хранение и создание экземпляра для каждой
+ * стратегии. Стратегия SCOPED статическим контейнером не поддерживается.
+ * @tparam S Описание сервиса Service<T, S, F, N>.
+ */
+template <typename S>
+class StaticSlot;
+
+/** @brief Слот синглтона
+ * @details Экземпляр создается при первом разрешении во встроенном буфере
+ * слота. Последующие разрешения сводятся к чтению указателя.
+ */
+template <typename T, typename F, size_t N>
+class StaticSlot<Service<T, SINGLETON, F, N> >
+    : protected StaticFactorySlot<F> {
+ private:
+  enum {
+    align = AlignmentOf<T>::value,
+    extra = static_cast<size_t>(align) >
+                    static_cast<size_t>(AlignmentOf<MaxAlign>::value)
+                ? align
+                : 0
+  };
+
+  T* m_instance;                                // Созданный экземпляр
+  AlignedStorage<sizeof(T) + extra> m_storage;  // Буфер для экземпляра
+
+  T* construct() {
+    if (!this->m_factory) return NULL;
+    void* mem = AlignPointer(m_storage.data, align);
+    return static_cast<T*>(this->m_factory->F::create(mem));
+  }
+
+ public:
+  StaticSlot() : m_instance(NULL) {}
+  ~StaticSlot() { release(); }
+
+  bool configure(const F& factory) {
+    if (m_instance) return false;
+    this->setFactory(factory);
+    return true;
+  }
+
+  T* resolve() {
+    if (!m_instance) m_instance = construct();
+    return m_instance;
+  }
+
+  void release() {
+    if (!m_instance) return;
+    this->m_factory->F::destroy(m_instance);
+    m_instance = NULL;
+  }
+};
+
+/** @brief Слот временного сервиса
+ * @details Каждый вызов resolve создает новый экземпляр в одной из N ячеек
+ * встроенного буфера слота, без обращения к куче. Свободные ячейки хранятся
+ * стеком номеров, поэтому создание и уничтожение стоят O(1). Когда все
+ * ячейки заняты, resolve возвращает NULL. Вызывающий код освобождает
+ * экземпляр через StaticContainer::destroyTransient; экземпляры, не
+ * освобожденные к уничтожению контейнера, уничтожает деструктор слота.
+ */
+template <typename T, typename F, size_t N>
+class StaticSlot<Service<T, TRANSIENT, F, N> >
+    : protected StaticFactorySlot<F> {
+ private:
+  enum {
+    align = AlignmentOf<T>::value,
+    extra = static_cast<size_t>(align) >
+                    static_cast<size_t>(AlignmentOf<MaxAlign>::value)
+                ? align
+                : 0
+  };
+
+  AlignedStorage<sizeof(T) * N + extra> m_storage;  // Ячейки экземпляров
+  size_t m_free[N];     // Стек номеров свободных ячеек
+  size_t m_free_count;  // Количество свободных ячеек
+  bool m_live[N];       // Занята ли ячейка экземпляром
+
+  /** @brief Адрес первой ячейки с учетом выравнивания T
+   */
+  unsigned char* cells() {
+    return static_cast<unsigned char*>(AlignPointer(m_storage.data, align));
+  }
+
+  /** @brief Номер ячейки экземпляра
+   * @return Номер ячейки или N, если экземпляр создан не этим слотом
+   */
+  size_t index_of(T* instance) {
+    unsigned char* p = reinterpret_cast<unsigned char*>(instance);
+    unsigned char* first = cells();
+    if (p < first || p >= first + sizeof(T) * N) return N;
+    size_t offset = static_cast<size_t>(p - first);
+    return offset % sizeof(T) == 0 ? offset / sizeof(T) : N;
+  }
+
+ public:
+  StaticSlot() : m_free_count(N) {
+    for (size_t i = 0; i < N; ++i) {
+      m_free[i] = N - 1 - i;
+      m_live[i] = false;
+    }
+  }
+
+  ~StaticSlot() {
+    for (size_t i = 0; i < N; ++i)
+      if (m_live[i]) reinterpret_cast<T*>(cells() + sizeof(T) * i)->~T();
+  }
+
+  bool configure(const F& factory) {
+    this->setFactory(factory);
+    return true;
+  }
+
+  T* resolve() {
+    if (!this->m_factory || m_free_count == 0) return NULL;
+    size_t index = m_free[--m_free_count];
+    m_live[index] = true;
+    void* mem = cells() + sizeof(T) * index;
+    return static_cast<T*>(this->m_factory->F::create(mem));
+  }
+
+  void destroy(T* instance) {
+    if (!instance) return;
+    size_t index = index_of(instance);
+    if (index == N || !m_live[index]) return;
+    instance->~T();
+    m_live[index] = false;
+    m_free[m_free_count++] = index;
+  }
+
+  void release() {}
+};
+
+/** @brief Слот внешнего экземпляра
+ * @details Хранит указатель на экземпляр, созданный вне контейнера.
+ * Контейнер не управляет временем жизни такого экземпляра.
+ */
+template <typename T, typename F, size_t N>
+class StaticSlot<Service<T, EXTERNAL, F, N> > {
+ private:
+  T* m_instance;  // Зарегистрированный экземпляр
+
+ public:
+  StaticSlot() : m_instance(NULL) {}
+
+  bool registerInstance(T* instance) {
+    if (!instance || m_instance) return false;
+    m_instance = instance;
+    return true;
+  }
+
+  T* resolve() { return m_instance; }
+
+  void release() {}
+};
+
+/** @brief Набор слотов для всех сервисов списка
+ * @details Каждый слот является базовым классом набора, поэтому расположение
+ * всех сервисов фиксируется на этапе компиляции.
+ * @tparam L Цепочка узлов списка типов.
+ */
+template <typename L>
+class StaticSlots;
+
+template <>
+class StaticSlots<NullType> {
+ protected:
+  void releaseAll() {}
+};
+
+template <typename S, typename Tail>
+class StaticSlots<TypeNode<S, Tail> > : public StaticSlot<S>,
+                                        public StaticSlots<Tail> {
+ protected:
+  void releaseAll() {
+    StaticSlots<Tail>::releaseAll();
+    StaticSlot<S>::release();
+  }
+};
+
+/** @brief Статический контейнер сервисов
+ *
+ * Набор сервисов и их стратегии задаются списком типов:
+ * @code
+ * typedef Knot::StaticContainer<Knot::TypeList<
+ *     Knot::Service<Config>,
+ *     Knot::Service<Logger, SINGLETON, Knot::Factory1<Logger, int> >,
+ *     Knot::Service<Request, TRANSIENT> > > AppContainer;
+ * @endcode
+ * Разрешение сервиса не выполняет поиска во время выполнения: слот сервиса
+ * находится компилятором, а для синглтона resolve сводится к чтению указателя
+ * и проверке, создан ли экземпляр. Разрешение незарегистрированного типа
+ * приводит к ошибке компиляции.
+ *
+ * @tparam List Список описаний сервисов TypeList<Service<...>, ...>.
+ */
+template <typename List>
+class StaticContainer : private StaticSlots<typename List::Type> {
+ private:
+  typedef typename List::Type Services;  // Цепочка узлов списка сервисов
+
+  StaticContainer(const StaticContainer&);  // Запрет копирования контейнера
+  StaticContainer& operator=(const StaticContainer&);  // Запрет присваивания
+
+  /** @brief Получение слота сервиса по его типу
+   * @tparam T Тип сервиса
+   * @return Ссылка на слот сервиса
+   */
+  template <typename T>
+  StaticSlot<typename FindService<Services, T>::Result>& slot() {
+    return *this;
+  }
+
+ public:
+  StaticContainer() {}
+
+  /** @brief Деструктор контейнера
+   * @details Уничтожает все созданные синглтоны в порядке, обратном порядку
+   * их перечисления в списке.
+   */
+  ~StaticContainer() { destroyAllSingletons(); }
+
+  /** @brief Количество сервисов в контейнере
+   * @return Длина списка сервисов
+   */
+  static size_t size() { return Length<Services>::value; }
+
+  CONFIGURE_GEN  // Макрос для настройки фабрик различной арности
+
+      /** @brief Регистрация внешнего экземпляра сервиса
+       * @tparam T Тип сервиса, объявленного со стратегией EXTERNAL
+       * @param instance Указатель на экземпляр сервиса
+       * @return true, если регистрация успешна, иначе false.
+       */
+      template <typename T>
+      bool registerInstance(T* instance) {
+    return slot<T>().registerInstance(instance);
+  }
+
+  /** @brief Получение сервиса по его типу
+   * @tparam T Тип сервиса, который нужно получить
+   * @return Указатель на сервис типа T, или NULL, если фабрика сервиса не
+   * настроена, внешний экземпляр не зарегистрирован или заняты все ячейки
+   * временного сервиса.
+   */
+  template <typename T>
+  T* resolve() {
+    return slot<T>().resolve();
+  }
+
+  /** @brief Уничтожение временного сервиса
+   * @details Освобождает ячейку слота для следующего resolve. Указатель,
+   * который не был получен из resolve, игнорируется.
+   * @tparam T Тип временного сервиса
+   * @param ptr Указатель, полученный из resolve
+   */
+  template <typename T>
+  void destroyTransient(T* ptr) {
+    slot<T>().destroy(ptr);
+  }
+
+  /** @brief Уничтожение всех созданных синглтонов
+   * @note После вызова синглтоны будут созданы заново при следующем resolve.
+   */
+  void destroyAllSingletons() {
+    StaticSlots<Services>::releaseAll();
+  }
+};
+};  // namespace Knot
+
+#endif  // STATIC_CONTAINER_HPP
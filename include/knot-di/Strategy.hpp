@@ -18,6 +18,9 @@
  * повторно для всех запросов.
  * TRANSIENT - сервис, который создается каждый раз при запросе
  * и уничтожается после использования.
+ * EXTERNAL - экземпляр, созданный вне контейнера.
+ * SCOPED - сервис, который создается один раз в пределах области видимости
+ * (Scope) и уничтожается вместе с ней.
  */
 enum Strategy { SINGLETON, TRANSIENT, EXTERNAL, SCOPED };
 
@@ -0,0 +1,204 @@
+/** @file Sync.hpp
+ * @brief Заголовочный файл для примитивов синхронизации контейнера
+ * @version 1.0
+ *
+ * Этот файл содержит атомарные операции и мьютекс, которые используются
+ * контейнером в потокобезопасном режиме (KNOT_THREAD_SAFE). Если режим
+ * выключен, все примитивы превращаются в обычные операции и не требуют
+ * pthread.
+ */
+#ifndef SYNC_HPP
+#define SYNC_HPP
+
+#include <cstddef>
+
+#ifndef KNOT_THREAD_SAFE
+#define KNOT_THREAD_SAFE 0
+#endif
+
+#if KNOT_THREAD_SAFE
+#include <pthread.h>
+#include <sched.h>
+#define KNOT_THREAD_LOCAL __thread  // Поточно-локальное хранение
+#else
+#define KNOT_THREAD_LOCAL  // В однопоточном режиме достаточно static
+#endif
+
+namespace Knot {
+#if KNOT_THREAD_SAFE
+/** @brief Чтение указателя с семантикой acquire
+ * @param ptr Адрес читаемого указателя.
+ * @return Прочитанное значение.
+ */
+inline void* LoadAcquire(void* const* ptr) {
+  return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+/** @brief Запись указателя с семантикой release
+ * @param ptr Адрес записываемого указателя.
+ * @param value Новое значение.
+ */
+inline void StoreRelease(void** ptr, void* value) {
+  __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+}
+
+/** @brief Атомарное чтение целого значения
+ * @param ptr Адрес значения.
+ * @return Прочитанное значение.
+ */
+inline size_t LoadAcquire(const size_t* ptr) {
+  return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+/** @brief Атомарная запись целого значения
+ * @param ptr Адрес значения.
+ * @param value Новое значение.
+ */
+inline void StoreRelease(size_t* ptr, size_t value) {
+  __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+}
+
+/** @brief Атомарное сравнение с обменом
+ * @param ptr Адрес значения.
+ * @param expected Ожидаемое значение.
+ * @param desired Значение, которое будет записано при совпадении.
+ * @return true, если значение совпало и было заменено.
+ */
+inline bool CompareExchange(size_t* ptr, size_t expected, size_t desired) {
+  return __atomic_compare_exchange_n(ptr, &expected, desired, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+/** @brief Атомарное увеличение значения
+ * @param ptr Адрес значения.
+ * @param value Величина увеличения.
+ * @return Значение до увеличения.
+ */
+inline size_t FetchAdd(size_t* ptr, size_t value) {
+  return __atomic_fetch_add(ptr, value, __ATOMIC_ACQ_REL);
+}
+
+/** @brief Идентификатор текущего потока
+ * @details Адрес поточно-локальной переменной уникален для каждого живого
+ * потока и не равен нулю.
+ * @return Ненулевой идентификатор потока.
+ */
+inline size_t CurrentThreadId() {
+  static KNOT_THREAD_LOCAL char marker;  // Уникальна для каждого потока
+  return reinterpret_cast<size_t>(&marker);
+}
+
+/** @brief Уступить процессор другим потокам
+ */
+inline void Yield() { sched_yield(); }
+
+/** @brief Задача для потоков RunParallel
+ */
+struct ParallelTask {
+  void (*fn)(void*);  // Функция, выполняемая каждым потоком
+  void* arg;          // Аргумент функции
+};
+
+/** @brief Точка входа потока RunParallel
+ * @param task Указатель на ParallelTask
+ * @return NULL
+ */
+inline void* ParallelEntry(void* task) {
+  ParallelTask* t = static_cast<ParallelTask*>(task);
+  t->fn(t->arg);
+  return NULL;
+}
+
+/** @brief Выполнение функции в нескольких потоках
+ * @details Запускает threads - 1 дополнительных потоков, выполняет функцию в
+ * текущем потоке и дожидается завершения остальных. Функция сама распределяет
+ * работу между потоками. Если поток создать не удалось, работу выполнят
+ * оставшиеся.
+ * @param fn Функция, выполняемая каждым потоком
+ * @param arg Аргумент функции, общий для всех потоков
+ * @param threads Общее количество потоков, включая текущий
+ */
+inline void RunParallel(void (*fn)(void*), void* arg, size_t threads) {
+  enum { MAX_THREADS = 64 };  // Ограничение числа дополнительных потоков
+  ParallelTask task = {fn, arg};
+  pthread_t workers[MAX_THREADS];
+  size_t started = 0;
+  for (size_t i = 1; i < threads && started < MAX_THREADS; ++i)
+    if (pthread_create(&workers[started], NULL, ParallelEntry, &task) == 0)
+      ++started;
+  fn(arg);
+  for (size_t i = 0; i < started; ++i) pthread_join(workers[i], NULL);
+}
+
+/** @brief Рекурсивный мьютекс
+ * @details Рекурсивность нужна, потому что фабрика сервиса может во время
+ * создания разрешать другие сервисы того же контейнера.
+ */
+class Mutex {
+ private:
+  Mutex(const Mutex&);
+  Mutex& operator=(const Mutex&);
+
+  pthread_mutex_t m_mutex;  // Мьютекс pthread
+
+ public:
+  Mutex() {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&m_mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+  }
+  ~Mutex() { pthread_mutex_destroy(&m_mutex); }
+
+  void lock() { pthread_mutex_lock(&m_mutex); }
+  void unlock() { pthread_mutex_unlock(&m_mutex); }
+};
+#else
+inline void* LoadAcquire(void* const* ptr) { return *ptr; }
+inline void StoreRelease(void** ptr, void* value) { *ptr = value; }
+inline size_t LoadAcquire(const size_t* ptr) { return *ptr; }
+inline void StoreRelease(size_t* ptr, size_t value) { *ptr = value; }
+
+inline bool CompareExchange(size_t* ptr, size_t expected, size_t desired) {
+  if (*ptr != expected) return false;
+  *ptr = desired;
+  return true;
+}
+
+inline size_t FetchAdd(size_t* ptr, size_t value) {
+  size_t old = *ptr;
+  *ptr += value;
+  return old;
+}
+
+inline size_t CurrentThreadId() { return 1; }
+inline void Yield() {}
+
+inline void RunParallel(void (*fn)(void*), void* arg, size_t) { fn(arg); }
+
+/** @brief Пустой мьютекс для однопоточного режима
+ */
+class Mutex {
+ public:
+  void lock() {}
+  void unlock() {}
+};
+#endif
+
+/** @brief Захват мьютекса на время жизни объекта
+ */
+class LockGuard {
+ private:
+  LockGuard(const LockGuard&);
+  LockGuard& operator=(const LockGuard&);
+
+  Mutex& m_mutex;  // Захваченный мьютекс
+
+ public:
+  explicit LockGuard(Mutex& mutex) : m_mutex(mutex) { m_mutex.lock(); }
+  ~LockGuard() { m_mutex.unlock(); }
+};
+};  // namespace Knot
+
+#endif  // SYNC_HPP
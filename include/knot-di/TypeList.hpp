@@ -0,0 +1,72 @@
+/** @file TypeList.hpp
+ * @brief Заголовочный файл для списков типов времени компиляции
+ * @version 1.0
+ *
+ * Этот файл содержит определение списка типов TypeList в стиле C++03, который
+ * используется для описания набора сервисов, известного на этапе компиляции.
+ */
+#ifndef TYPE_LIST_HPP
+#define TYPE_LIST_HPP
+
+namespace Knot {
+/** @brief Пустой тип, обозначающий конец списка и незаданные параметры
+ */
+struct NullType {};
+
+/** @brief Узел списка типов
+ * @details Список типов хранится как цепочка узлов TypeNode, оканчивающаяся
+ * NullType.
+ * @tparam H Тип, хранящийся в узле.
+ * @tparam T Оставшаяся часть списка.
+ */
+template <typename H, typename T>
+struct TypeNode {
+  typedef H Head;  // Тип, хранящийся в узле
+  typedef T Tail;  // Оставшаяся часть списка
+};
+
+/** @brief Список типов фиксированной максимальной длины
+ * @details Позволяет записать список типов без вложенных TypeNode:
+ * TypeList<A, B, C>. Результирующая цепочка узлов доступна через вложенный
+ * тип Type. Поддерживается до 16 элементов.
+ */
+template <typename T1 = NullType, typename T2 = NullType,
+          typename T3 = NullType, typename T4 = NullType,
+          typename T5 = NullType, typename T6 = NullType,
+          typename T7 = NullType, typename T8 = NullType,
+          typename T9 = NullType, typename T10 = NullType,
+          typename T11 = NullType, typename T12 = NullType,
+          typename T13 = NullType, typename T14 = NullType,
+          typename T15 = NullType, typename T16 = NullType>
+struct TypeList {
+  typedef TypeNode<T1, typename TypeList<T2, T3, T4, T5, T6, T7, T8, T9, T10,
+                                         T11, T12, T13, T14, T15,
+                                         T16>::Type>
+      Type;  // Цепочка узлов списка
+};
+
+/** @brief Специализация TypeList для пустого списка
+ */
+template <>
+struct TypeList<> {
+  typedef NullType Type;  // Пустой список
+};
+
+/** @brief Длина списка типов
+ * @tparam L Цепочка узлов TypeNode или NullType.
+ */
+template <typename L>
+struct Length;
+
+template <>
+struct Length<NullType> {
+  enum { value = 0 };
+};
+
+template <typename H, typename T>
+struct Length<TypeNode<H, T> > {
+  enum { value = 1 + Length<T>::value };
+};
+};  // namespace Knot
+
+#endif  // TYPE_LIST_HPP
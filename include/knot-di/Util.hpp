@@ -10,8 +10,9 @@
 #define UTIL_HPP
 
 #include <cstddef>
+#include <stdint.h>
 
-#include "Descriptor.hpp"
+#include "Sync.hpp"
 
 namespace Knot {
 /** @brief Функция для получения уникального идентификатора типа
@@ -28,25 +29,278 @@ void* TypeId() {
   return &id;      // Возвращаем указатель на уникальный идентификатор типа
 }
 
+/** @brief Счетчик плотных индексов типов
+ * @details Возвращает ссылку на глобальный счетчик, из которого каждому типу
+ * при первом обращении к TypeIndex выдается очередной индекс.
+ * @return Ссылка на счетчик выданных индексов.
+ */
+inline size_t& TypeIndexCounter() {
+  static size_t counter = 0;  // Количество уже выданных индексов
+  return counter;
+}
+
+/** @brief Функция для получения плотного индекса типа
+ * @details Работает по тому же принципу, что и TypeId: статическая переменная
+ * уникальна для каждого типа T, но вместо адреса хранит порядковый номер,
+ * выданный при первом обращении. Индексы идут подряд начиная с нуля, поэтому
+ * их можно использовать для прямой адресации в массиве.
+ *
+ * @tparam T Тип, для которого нужно получить индекс.
+ * @return Плотный индекс типа T.
+ */
+template <typename T>
+size_t TypeIndex() {
+  static const size_t index = FetchAdd(&TypeIndexCounter(), 1);  // Индекс T
+  return index;
+}
+
+/** @brief Хеш идентификатора типа и ключа регистрации
+ * @details Мультипликативное (фибоначчиево) хеширование: значение умножается
+ * на 2^W / φ, где W - разрядность size_t, а номером ячейки служат старшие
+ * биты произведения. Идентификаторы типов - адреса статических переменных,
+ * которые обычно лежат подряд, и такие адреса, как и последовательные
+ * целые ключи, распределяются по таблице почти без коллизий.
+ * @param tid Идентификатор типа, полученный из TypeId
+ * @param key Значение ключа ServiceKey или 0 для регистрации без ключа
+ * @return Хеш пары; ячейка таблицы из 2^k элементов - это старшие k бит
+ * хеша.
+ */
+inline size_t HashTypeId(const void* tid, size_t key = 0) {
+  const size_t golden =
+      (static_cast<size_t>(0x9e3779b9U) << 16 << 16) | 0x7f4a7c15U;
+  return ((reinterpret_cast<size_t>(tid) * golden) ^ key) * golden;
+}
+
+/** @brief Признак целочисленного типа ключа регистрации
+ * @details Определен только для целочисленных типов, поэтому ServiceKey
+ * неявно создается из целого числа или строки, но не из других значений.
+ */
+template <typename I>
+struct IntegralKey {};
+
+#define KNOT_INTEGRAL_KEY(I) \
+  template <>                \
+  struct IntegralKey<I> {    \
+    typedef size_t Type;     \
+  };
+KNOT_INTEGRAL_KEY(char)
+KNOT_INTEGRAL_KEY(signed char)
+KNOT_INTEGRAL_KEY(unsigned char)
+KNOT_INTEGRAL_KEY(short)
+KNOT_INTEGRAL_KEY(unsigned short)
+KNOT_INTEGRAL_KEY(int)
+KNOT_INTEGRAL_KEY(unsigned int)
+KNOT_INTEGRAL_KEY(long)
+KNOT_INTEGRAL_KEY(unsigned long)
+#undef KNOT_INTEGRAL_KEY
+
+/** @brief Ключ именованной регистрации
+ * @details Позволяет зарегистрировать несколько сервисов одного типа,
+ * например по пулу соединений на каждый шард. Ключом служит целое число или
+ * строка. Строка хешируется (FNV-1a) один раз при создании ключа, поэтому
+ * ключ, сохраненный заранее, не требует повторного хеширования при
+ * разрешении. Целые и строковые ключи хранятся в реестре под разными тегами
+ * типа и не пересекаются; строковые ключи с равным хешем различаются
+ * сравнением строк.
+ * @note Ключ хранит указатель на строку, а не ее копию: строка должна жить,
+ * пока используется ключ. Контейнер копирует строку при регистрации.
+ */
+struct ServiceKey {
+  size_t value;      // Целый ключ или хеш строки
+  const char* name;  // Строка ключа или NULL для целого ключа
+
+  /** @brief Ключ из строки
+   * @param name Строка, оканчивающаяся нулем
+   */
+  ServiceKey(const char* name) : value(HashName(name)), name(name) {}
+
+  /** @brief Ключ из целого числа
+   * @tparam I Целочисленный тип
+   * @param id Значение ключа
+   */
+  template <typename I>
+  ServiceKey(I id, typename IntegralKey<I>::Type* = 0)
+      : value(static_cast<size_t>(id)), name(NULL) {}
+
+  /** @brief Хеш строки FNV-1a разрядности size_t
+   * @param name Строка, оканчивающаяся нулем
+   * @return Хеш строки
+   */
+  static size_t HashName(const char* name) {
+    const bool wide = sizeof(size_t) > 4;
+    size_t h = wide ? (static_cast<size_t>(0xcbf29ce4U) << 16 << 16) |
+                          0x84222325U
+                    : 0x811c9dc5U;
+    const size_t prime =
+        wide ? (static_cast<size_t>(0x100U) << 16 << 16) | 0x1b3U
+             : 0x1000193U;
+    for (; *name; ++name) {
+      h ^= static_cast<unsigned char>(*name);
+      h *= prime;
+    }
+    return h;
+  }
+};
+
+/** @brief Тег типа для регистраций с целым ключом
+ * @details Записи с ключом хранятся в реестре под идентификатором
+ * TypeId<Keyed<T> >(), поэтому они не пересекаются с регистрацией T без
+ * ключа.
+ * @tparam T Тип сервиса
+ */
+template <typename T>
+struct Keyed {};
+
+/** @brief Тег типа для регистраций со строковым ключом
+ * @details Отделяет строковые ключи от целых: хеш строки может совпасть с
+ * целым ключом той же регистрации.
+ * @tparam T Тип сервиса
+ */
+template <typename T>
+struct Named {};
+
+struct Descriptor;
+
+#ifndef KNOT_MAX_RESOLVE_DEPTH
+#define KNOT_MAX_RESOLVE_DEPTH 64  // Максимальная глубина вложенного resolve
+#endif
+
+/** @brief Стек сервисов, создаваемых текущим потоком
+ * @details Хранит дескрипторы сервисов, фабрики которых выполняются в данный
+ * момент. Фабрика с внедряемыми зависимостями разрешает их внутри create,
+ * поэтому стек повторяет путь по графу зависимостей от корня до текущего
+ * сервиса.
+ */
+struct ResolveStack {
+  const Descriptor* entries[KNOT_MAX_RESOLVE_DEPTH];  // Путь по графу
+  size_t depth;   // Количество сервисов в стеке
+  size_t cycles;  // Количество отказов из-за цикла или глубины графа
+};
+
+/** @brief Стек создаваемых сервисов текущего потока
+ * @return Ссылка на стек, отдельный для каждого потока.
+ */
+inline ResolveStack& CurrentResolveStack() {
+  static KNOT_THREAD_LOCAL ResolveStack stack;  // Стек текущего потока
+  return stack;
+}
+
+/** @brief Защита от циклических зависимостей при создании сервиса
+ * @details На время жизни объекта помещает дескриптор в стек создаваемых
+ * сервисов. Если дескриптор уже находится в стеке, значит сервис прямо или
+ * через другие сервисы зависит сам от себя, и создание запрещается. Проверка
+ * стоит O(глубины графа) и выполняется только при создании экземпляра.
+ * Каждый отказ учитывается в стеке, поэтому все сервисы на пути к циклу
+ * узнают, что их зависимости недостроены, и тоже не создаются.
+ */
+class ResolveGuard {
+ private:
+  ResolveGuard(const ResolveGuard&);
+  ResolveGuard& operator=(const ResolveGuard&);
+
+  bool m_entered;   // Дескриптор помещен в стек этим объектом
+  size_t m_cycles;  // Значение ResolveStack::cycles при входе
+
+ public:
+  explicit ResolveGuard(const Descriptor& desc)
+      : m_entered(false), m_cycles(0) {
+    ResolveStack& stack = CurrentResolveStack();
+    m_cycles = stack.cycles;
+    if (stack.depth >= KNOT_MAX_RESOLVE_DEPTH) {
+      reportCycle();
+      return;
+    }
+    for (size_t i = 0; i < stack.depth; ++i) {
+      if (stack.entries[i] == &desc) {
+        reportCycle();
+        return;
+      }
+    }
+    stack.entries[stack.depth++] = &desc;
+    m_entered = true;
+  }
+
+  ~ResolveGuard() {
+    if (m_entered) --CurrentResolveStack().depth;
+  }
+
+  /** @brief Можно ли создавать сервис
+   * @return false, если обнаружен цикл или превышена глубина графа.
+   */
+  bool entered() const { return m_entered; }
+
+  /** @brief Отказал ли цикл в разрешении зависимости этого сервиса
+   * @return true, если после входа в стек обнаружен цикл или превышена
+   * глубина графа: созданный экземпляр получил NULL вместо зависимости.
+   */
+  bool dependencyFailed() const {
+    return CurrentResolveStack().cycles != m_cycles;
+  }
+
+  /** @brief Учет отказа из-за цикла
+   */
+  static void reportCycle() { ++CurrentResolveStack().cycles; }
+};
+
 /** @brief Структура для хранения информации о временных сервисах
  * @details Эта структура используется для хранения информации о временных
- * сервисах, включая указатель на экземпляр, фабрику, которая создает этот
- * экземпляр, и размер выделенной памяти.
+ * сервисах, включая указатель на экземпляр, дескриптор сервиса, фабрика
+ * которого создала этот экземпляр, и размер выделенной памяти.
  */
 struct TransientInfo {
-  void* ptr;          // Указатель на экземпляр временного сервиса
-  IFactory* factory;  // Указатель на фабрику, которая создает этот экземпляр
-  size_t alloc_size;  // Размер выделенной памяти для этого экземпляра
+  void* ptr;            // Память экземпляра временного сервиса
+  void* instance;       // Указатель на экземпляр, выданный вызывающему коду
+  Descriptor* desc;     // Дескриптор сервиса, создавшего этот экземпляр
+  size_t alloc_size;    // Размер выделенной памяти для этого экземпляра
+  size_t count;         // Количество экземпляров, размещенных подряд
+  uint32_t generation;  // Поколение записи, увеличивается при уничтожении
+  bool recycle;  // Память возвращается в список повторного использования desc
+  bool in_request;  // Память выделена из арены запроса (beginRequest)
 };
 
-/** @brief Структура для хранения информации о сервисах в реестре
- * @details Эта структура используется для хранения информации о сервисах в
- * реестре, включая указатель на тип сервиса и дескриптор, содержащий информацию
- * о фабрике, стратегии создания и экземпляре.
+/** @brief Статистика повторного использования памяти временного сервиса
  */
-struct RegistryEntry {
-  void* type;       // Указатель на уникальный идентификатор типа сервиса
-  Descriptor desc;  // Дескриптор, содержащий информацию о сервисе
+struct RecycleStats {
+  size_t hits;    // Создания из блока списка, без обращения к пулу
+  size_t misses;  // Создания с выделением памяти из пула
+  size_t cached;  // Количество блоков в списке
+  size_t limit;   // Максимальное количество блоков в списке
+};
+
+/** @brief Дескриптор временного сервиса
+ * @details Содержит номер записи в массиве временных сервисов контейнера и
+ * поколение этой записи на момент создания экземпляра. Проверка и
+ * уничтожение по дескриптору выполняются за O(1), а несовпадение поколения
+ * выявляет устаревший дескриптор или повторное уничтожение.
+ */
+struct TransientHandle {
+  uint32_t index;       // Номер записи временного сервиса
+  uint32_t generation;  // Поколение записи; 0 - недействительный дескриптор
+
+  TransientHandle() : index(0), generation(0) {}
+};
+
+/** @brief Запись журнала созданных экземпляров контейнера
+ * @details Журнал упорядочен по завершению создания: зависимость, созданная
+ * фабрикой зависимого сервиса, записывается раньше него. Поэтому обход
+ * журнала с конца уничтожает зависимые экземпляры раньше их зависимостей.
+ */
+struct CreationRecord {
+  Descriptor* singleton;      // Дескриптор синглтона или NULL
+  TransientHandle transient;  // Временный сервис, если singleton равен NULL
+};
+
+/** @brief Наименьшая степень двойки, не меньшая N
+ * @tparam N Нижняя граница
+ */
+template <size_t N, size_t P = 1, bool Done = (P >= N)>
+struct PowerOfTwoAtLeast {
+  enum { value = PowerOfTwoAtLeast<N, P * 2>::value };
+};
+
+template <size_t N, size_t P>
+struct PowerOfTwoAtLeast<N, P, true> {
+  enum { value = P };
 };
 
 /** @brief Структура для получения выравнивания типа
@@ -65,6 +319,52 @@ struct AlignmentOf {
   enum { value = sizeof(Helper) - sizeof(T) };
 };
 
+/** @brief Объединение типов с наибольшим фундаментальным выравниванием
+ * @details Используется как член AlignedStorage, чтобы выровнять сырой буфер
+ * по самому строгому выравниванию, доступному без средств C++11.
+ */
+union MaxAlign {
+  long l;            // Целое максимального размера
+  double d;          // Вещественное двойной точности
+  long double ld;    // Вещественное расширенной точности
+  void* p;           // Указатель на данные
+  void (*fp)(void);  // Указатель на функцию
+};
+
+/** @brief Сырой буфер заданного размера с выравниванием MaxAlign
+ * @details Позволяет разместить объект внутри другого объекта без вызова его
+ * конструктора до момента явного placement new.
+ *
+ * @tparam Size Размер буфера в байтах.
+ */
+template <size_t Size>
+union AlignedStorage {
+  unsigned char data[Size];  // Байты буфера
+  MaxAlign align;            // Выравнивающий член
+};
+
+/** @brief Проверка условия на этапе компиляции
+ * @details Специализация определена только для true, поэтому sizeof от
+ * CompileCheck<false> приводит к ошибке компиляции.
+ */
+template <bool Condition>
+struct CompileCheck;
+
+template <>
+struct CompileCheck<true> {
+  enum { value = 1 };
+};
+
+/** @brief Функция для выравнивания указателя вверх
+ * @param ptr Исходный указатель.
+ * @param align Требуемое выравнивание в байтах.
+ * @return Наименьший адрес не меньше ptr, кратный align.
+ */
+inline void* AlignPointer(void* ptr, size_t align) {
+  size_t misalign = reinterpret_cast<size_t>(ptr) % align;
+  return static_cast<unsigned char*>(ptr) + (misalign ? align - misalign : 0);
+}
+
 /** @brief Структура для получения типа элемента массива
  * @details Эта структура используется для получения типа элемента массива T[N].
  * Если T является массивом, то возвращается тип элемента массива, иначе
@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+
+#include <type_traits>
+
+#include "../include/knot-di/Scope.hpp"
+
+namespace {
+struct Config {
+  int value;
+  explicit Config(int v) : value(v) {}
+};
+
+struct Clock {
+  int ticks;
+  Clock() : ticks(0) {}
+};
+
+struct Tenant {
+  static int destructed;
+  int id;
+  explicit Tenant(int i) : id(i) {}
+  ~Tenant() { ++destructed; }
+};
+int Tenant::destructed = 0;
+
+struct Request {
+  int id;
+  Request() : id(3) {}
+};
+}  // namespace
+
+static_assert(!std::is_constructible<Knot::Container, Knot::Container&>::value,
+              "copy syntax must not create a child container");
+
+TEST(ChildContainerTest, FallsBackToParentRegistrations) {
+  Knot::Container parent;
+  ASSERT_TRUE(parent.registerService<Config>(SINGLETON, 1));
+  ASSERT_TRUE(parent.registerService<Clock>(SINGLETON));
+  ASSERT_TRUE(parent.registerService<Config>("backup", SINGLETON, 2));
+  Clock* clock = parent.resolve<Clock>();
+
+  Knot::Container child(Knot::CHILD_OF, parent);
+  EXPECT_EQ(child.resolve<Clock>(), clock);
+  EXPECT_EQ(child.resolve<Config>(), parent.resolve<Config>());
+  EXPECT_EQ(child.resolve<Config>("backup")->value, 2);
+  EXPECT_EQ(child.resolve<Request>(), nullptr);
+  EXPECT_TRUE(child.handle<Clock>().valid());
+}
+
+TEST(ChildContainerTest, OverridesShadowParent) {
+  Knot::Container parent;
+  ASSERT_TRUE(parent.registerService<Config>(SINGLETON, 1));
+  Knot::Container child(Knot::CHILD_OF, parent);
+  ASSERT_TRUE(child.registerService<Config>(SINGLETON, 2));
+  ASSERT_TRUE(child.registerService<Config>("local", SINGLETON, 3));
+
+  EXPECT_EQ(child.resolve<Config>()->value, 2);
+  EXPECT_EQ(parent.resolve<Config>()->value, 1);
+  EXPECT_EQ(child.resolve<Config>("local")->value, 3);
+  EXPECT_EQ(parent.resolve<Config>("local"), nullptr);
+  EXPECT_FALSE(child.registerService<Config>(SINGLETON, 4));
+}
+
+TEST(ChildContainerTest, ParentSingletonsAreBuiltOnceByParent) {
+  Knot::Container parent;
+  ASSERT_TRUE(parent.registerService<Clock>(SINGLETON));
+  Clock* first = NULL;
+  {
+    Knot::Container child(Knot::CHILD_OF, parent);
+    first = child.resolve<Clock>();
+    ASSERT_NE(first, nullptr);
+  }
+  Knot::Container other(Knot::CHILD_OF, parent);
+  EXPECT_EQ(other.resolve<Clock>(), first);
+  EXPECT_EQ(parent.resolve<Clock>(), first);
+}
+
+TEST(ChildContainerTest, TransientsAreOwnedByChild) {
+  Tenant::destructed = 0;
+  Knot::Container parent;
+  ASSERT_TRUE(parent.registerService<Tenant>(TRANSIENT, 9));
+  {
+    Knot::Container child(Knot::CHILD_OF, parent);
+    Tenant* a = child.resolve<Tenant>();
+    Tenant* b = child.resolve<Tenant>();
+    ASSERT_NE(a, nullptr);
+    ASSERT_NE(b, nullptr);
+    EXPECT_EQ(a->id, 9);
+    child.destroyTransient(a);
+    EXPECT_EQ(Tenant::destructed, 1);
+    EXPECT_EQ(parent.recycleStats<Tenant>().cached, 0u);
+    EXPECT_FALSE(child.setRecycleLimit<Tenant>(0));
+  }
+  EXPECT_EQ(Tenant::destructed, 2);
+  EXPECT_NE(parent.resolve<Tenant>(), nullptr);
+}
+
+TEST(ChildContainerTest, ParentRegistrationIsLockedWhileChildrenLive) {
+  Knot::Container parent;
+  {
+    Knot::Container child(Knot::CHILD_OF, parent);
+    EXPECT_FALSE(parent.registerService<Clock>(SINGLETON));
+    EXPECT_TRUE(child.registerService<Clock>(SINGLETON));
+  }
+  EXPECT_TRUE(parent.registerService<Clock>(SINGLETON));
+}
+
+TEST(ChildContainerTest, GrandchildWalksTheChain) {
+  Knot::Container root;
+  ASSERT_TRUE(root.registerService<Clock>(SINGLETON));
+  Knot::Container tenant(Knot::CHILD_OF, root);
+  ASSERT_TRUE(tenant.registerService<Config>(SINGLETON, 7));
+  Knot::Container request(Knot::CHILD_OF, tenant);
+  ASSERT_TRUE(request.registerService<Request>(SCOPED));
+
+  EXPECT_EQ(request.resolve<Clock>(), root.resolve<Clock>());
+  EXPECT_EQ(request.resolve<Config>(), tenant.resolve<Config>());
+  EXPECT_EQ(root.resolve<Config>(), nullptr);
+
+  Knot::Scope scope(request);
+  Request* r = scope.resolve<Request>();
+  ASSERT_NE(r, nullptr);
+  EXPECT_EQ(scope.resolve<Request>(), r);
+  EXPECT_EQ(scope.resolve<Clock>(), root.resolve<Clock>());
+}
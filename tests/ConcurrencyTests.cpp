@@ -0,0 +1,306 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "../include/knot-di/Container.hpp"
+
+namespace {
+struct SlowSingleton {
+  static int constructed;
+  int x;
+  SlowSingleton() : x(7) {
+    __atomic_add_fetch(&constructed, 1, __ATOMIC_RELAXED);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+};
+int SlowSingleton::constructed = 0;
+
+struct ThreadTransient {
+  int x;
+  ThreadTransient() : x(3) {}
+};
+
+struct TeardownSingleton {
+  int x;
+  TeardownSingleton() : x(5) {}
+};
+
+struct CountedTransient {
+  static int constructed;
+  static int destructed;
+  int x;
+  CountedTransient() : x(9) {
+    std::this_thread::yield();
+    __atomic_add_fetch(&constructed, 1, __ATOMIC_RELAXED);
+  }
+  ~CountedTransient() { __atomic_add_fetch(&destructed, 1, __ATOMIC_RELAXED); }
+};
+int CountedTransient::constructed = 0;
+int CountedTransient::destructed = 0;
+
+struct CycleA;
+struct CycleB {
+  CycleA* a;
+  explicit CycleB(Knot::Container* c);
+};
+struct CycleA {
+  CycleB* b;
+  explicit CycleA(Knot::Container* c) : b(c->resolve<CycleB>()) {}
+};
+CycleB::CycleB(Knot::Container* c) : a(c->resolve<CycleA>()) {}
+
+// Оба конструктора ждут друг друга, поэтому каждый поток создает свой
+// синглтон цикла и только потом разрешает второй.
+int cross_arrived = 0;
+void ArriveAtCrossCycle() {
+  __atomic_add_fetch(&cross_arrived, 1, __ATOMIC_RELAXED);
+  while (__atomic_load_n(&cross_arrived, __ATOMIC_RELAXED) < 2)
+    std::this_thread::yield();
+}
+
+struct CrossA;
+struct CrossB {
+  CrossA* a;
+  explicit CrossB(Knot::Container* c);
+};
+struct CrossA {
+  CrossB* b;
+  explicit CrossA(Knot::Container* c) : b(NULL) {
+    ArriveAtCrossCycle();
+    b = c->resolve<CrossB>();
+  }
+};
+CrossB::CrossB(Knot::Container* c) : a(NULL) {
+  ArriveAtCrossCycle();
+  a = c->resolve<CrossA>();
+}
+
+template <int N>
+struct SlowLeaf {
+  static int constructed;
+  SlowLeaf() {
+    __atomic_add_fetch(&constructed, 1, __ATOMIC_RELAXED);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+};
+template <int N>
+int SlowLeaf<N>::constructed = 0;
+
+struct SlowRoot {
+  SlowLeaf<1>* a;
+  SlowLeaf<2>* b;
+  SlowLeaf<3>* c;
+  SlowRoot(SlowLeaf<1>* a_, SlowLeaf<2>* b_, SlowLeaf<3>* c_)
+      : a(a_), b(b_), c(c_) {}
+};
+}  // namespace
+
+TEST(ConcurrencyTest, WarmUpBuildsLevelsInParallel) {
+  Knot::Container container;
+  container.registerService<SlowRoot>(SINGLETON,
+                                      container.inject<SlowLeaf<1> >(),
+                                      container.inject<SlowLeaf<2> >(),
+                                      container.inject<SlowLeaf<3> >());
+  container.registerService<SlowLeaf<1> >(SINGLETON);
+  container.registerService<SlowLeaf<2> >(SINGLETON);
+  container.registerService<SlowLeaf<3> >(SINGLETON);
+
+  EXPECT_EQ(container.warmUp(4), 4u);
+  EXPECT_EQ(SlowLeaf<1>::constructed, 1);
+  EXPECT_EQ(SlowLeaf<2>::constructed, 1);
+  EXPECT_EQ(SlowLeaf<3>::constructed, 1);
+
+  SlowRoot* root = container.resolve<SlowRoot>();
+  ASSERT_NE(root, nullptr);
+  EXPECT_EQ(root->a, container.resolve<SlowLeaf<1> >());
+  EXPECT_EQ(root->b, container.resolve<SlowLeaf<2> >());
+  EXPECT_EQ(root->c, container.resolve<SlowLeaf<3> >());
+}
+
+TEST(ConcurrencyTest, SingletonIsConstructedOnce) {
+  SlowSingleton::constructed = 0;
+  Knot::Container container;
+  container.registerService<SlowSingleton>(SINGLETON);
+
+  const int threads = 8;
+  std::vector<SlowSingleton*> results(threads, nullptr);
+  std::vector<std::thread> workers;
+  for (int i = 0; i < threads; ++i)
+    workers.emplace_back([&container, &results, i] {
+      results[i] = container.resolve<SlowSingleton>();
+    });
+  for (size_t i = 0; i < workers.size(); ++i) workers[i].join();
+
+  EXPECT_EQ(SlowSingleton::constructed, 1);
+  ASSERT_NE(results[0], nullptr);
+  for (int i = 0; i < threads; ++i) EXPECT_EQ(results[i], results[0]);
+  EXPECT_EQ(results[0]->x, 7);
+}
+
+TEST(ConcurrencyTest, ChildContainersPerThreadShareParentSingletons) {
+  SlowSingleton::constructed = 0;
+  Knot::Container parent(1 << 16);
+  parent.registerService<SlowSingleton>(SINGLETON);
+  parent.registerService<ThreadTransient>(TRANSIENT);
+
+  const int threads = 4;
+  std::vector<SlowSingleton*> results(threads, nullptr);
+  std::vector<int> failures(threads, 0);
+  std::vector<std::thread> workers;
+  for (int i = 0; i < threads; ++i)
+    workers.emplace_back([&parent, &results, &failures, i] {
+      for (int n = 0; n < 1000; ++n) {
+        Knot::Container request(Knot::CHILD_OF, parent);
+        results[i] = request.resolve<SlowSingleton>();
+        ThreadTransient* t = request.resolve<ThreadTransient>();
+        if (!t || t->x != 3) ++failures[i];
+      }
+    });
+  for (size_t i = 0; i < workers.size(); ++i) workers[i].join();
+
+  EXPECT_EQ(SlowSingleton::constructed, 1);
+  for (int i = 0; i < threads; ++i) {
+    EXPECT_EQ(results[i], results[0]);
+    EXPECT_EQ(failures[i], 0);
+  }
+  EXPECT_TRUE(parent.registerService<SlowLeaf<1> >(SINGLETON));
+}
+
+TEST(ConcurrencyTest, TransientsFromManyThreads) {
+  Knot::Container container(1 << 16);
+  container.registerService<ThreadTransient>(TRANSIENT);
+
+  const int threads = 4;
+  std::vector<int> failures(threads, 0);
+  std::vector<std::thread> workers;
+  for (int i = 0; i < threads; ++i)
+    workers.emplace_back([&container, &failures, i] {
+      for (int n = 0; n < 10000; ++n) {
+        Knot::TransientHandle handle;
+        ThreadTransient* t = container.resolve<ThreadTransient>(handle);
+        if (!t || t->x != 3 || !container.destroyTransient(handle))
+          ++failures[i];
+      }
+    });
+  for (size_t i = 0; i < workers.size(); ++i) workers[i].join();
+
+  for (int i = 0; i < threads; ++i) EXPECT_EQ(failures[i], 0);
+}
+
+TEST(ConcurrencyTest, SingletonTeardownDuringTransientCreation) {
+  Knot::Container container(1 << 16);
+  container.registerService<TeardownSingleton>(SINGLETON);
+  container.registerService<ThreadTransient>(TRANSIENT);
+
+  const int threads = 4;
+  std::vector<int> failures(threads, 0);
+  std::vector<std::thread> workers;
+  for (int i = 0; i < threads; ++i)
+    workers.emplace_back([&container, &failures, i] {
+      for (int n = 0; n < 5000; ++n) {
+        Knot::TransientHandle handle;
+        ThreadTransient* t = container.resolve<ThreadTransient>(handle);
+        if (!t || t->x != 3 || !container.destroyTransient(handle))
+          ++failures[i];
+      }
+    });
+  int teardown_failures = 0;
+  for (int n = 0; n < 5000; ++n) {
+    TeardownSingleton* s = container.resolve<TeardownSingleton>();
+    if (!s || s->x != 5) ++teardown_failures;
+    container.destroyAllSingletons();
+  }
+  for (size_t i = 0; i < workers.size(); ++i) workers[i].join();
+
+  EXPECT_EQ(teardown_failures, 0);
+  for (int i = 0; i < threads; ++i) EXPECT_EQ(failures[i], 0);
+}
+
+TEST(ConcurrencyTest, TransientTeardownKeepsSlotsBeingBuilt) {
+  CountedTransient::constructed = 0;
+  CountedTransient::destructed = 0;
+  {
+    Knot::Container container(1 << 16);
+    container.registerService<CountedTransient>(TRANSIENT);
+
+    const int threads = 4;
+    int running = threads;
+    std::vector<int> failures(threads, 0);
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; ++i)
+      workers.emplace_back([&container, &failures, &running, i] {
+        for (int n = 0; n < 500; ++n) {
+          Knot::TransientHandle handle;
+          CountedTransient* t = container.resolve<CountedTransient>(handle);
+          // t может быть уже уничтожен основным потоком, поэтому
+          // проверяется только дескриптор, а не содержимое экземпляра.
+          CountedTransient* found =
+              container.getTransient<CountedTransient>(handle);
+          if (!t || (found && found != t)) ++failures[i];
+          container.destroyTransient(handle);
+        }
+        __atomic_sub_fetch(&running, 1, __ATOMIC_RELEASE);
+      });
+    while (__atomic_load_n(&running, __ATOMIC_ACQUIRE))
+      container.destroyAllTransients();
+    for (size_t i = 0; i < workers.size(); ++i) workers[i].join();
+
+    for (int i = 0; i < threads; ++i) EXPECT_EQ(failures[i], 0);
+  }
+  EXPECT_EQ(CountedTransient::destructed, CountedTransient::constructed);
+}
+
+TEST(ConcurrencyTest, CyclicSingletonResolvesToNull) {
+  Knot::Container container;
+  container.registerService<CycleA>(SINGLETON, &container);
+  container.registerService<CycleB>(SINGLETON, &container);
+
+  EXPECT_EQ(container.resolve<CycleA>(), nullptr);
+  EXPECT_EQ(container.resolve<CycleB>(), nullptr);
+}
+
+TEST(ConcurrencyTest, CycleSplitAcrossThreadsTerminates) {
+  cross_arrived = 0;
+  Knot::Container container;
+  container.registerService<CrossA>(SINGLETON, &container);
+  container.registerService<CrossB>(SINGLETON, &container);
+
+  CrossA* a = nullptr;
+  CrossB* b = nullptr;
+  std::thread first([&container, &a] { a = container.resolve<CrossA>(); });
+  std::thread second([&container, &b] { b = container.resolve<CrossB>(); });
+  first.join();
+  second.join();
+
+  EXPECT_EQ(a, nullptr);
+  EXPECT_EQ(b, nullptr);
+}
+
+TEST(ConcurrencyTest, SealedRegistryRejectsLateRegistration) {
+  Knot::Container container(1 << 16);
+  container.registerService<SlowSingleton>(SINGLETON);
+  container.registerService<ThreadTransient>(TRANSIENT);
+  ASSERT_TRUE(container.seal());
+
+  const int threads = 4;
+  std::vector<int> failures(threads, 0);
+  std::vector<std::thread> workers;
+  for (int i = 0; i < threads; ++i)
+    workers.emplace_back([&container, &failures, i] {
+      if (container.registerService<CycleA>(SINGLETON, &container))
+        ++failures[i];
+      for (int n = 0; n < 1000; ++n) {
+        Knot::TransientHandle handle;
+        if (!container.resolve<SlowSingleton>() ||
+            !container.resolve<ThreadTransient>(handle) ||
+            !container.destroyTransient(handle))
+          ++failures[i];
+      }
+    });
+  for (size_t i = 0; i < workers.size(); ++i) workers[i].join();
+
+  for (int i = 0; i < threads; ++i) EXPECT_EQ(failures[i], 0);
+  EXPECT_EQ(container.resolve<CycleA>(), nullptr);
+}
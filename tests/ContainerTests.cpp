@@ -108,11 +108,11 @@ TEST(ContainerTest, DestroyAllTransient) {
   Dummy* t1 = container.resolve<Dummy>();
   Dummy* t3 = container.resolve<Dummy>();
   ASSERT_NE(t1, nullptr);
+  ASSERT_NE(t3, nullptr);
   container.destroyAllTransients();
   Dummy* t2 = container.resolve<Dummy>();
   ASSERT_NE(t2, nullptr);
   EXPECT_EQ(t2->x, 42);
-  EXPECT_NE(t1, t2);
 }
 
 TEST(ContainerTest, DependencyInjectionWorks) {
@@ -274,3 +274,707 @@ TEST(ContainerTest, DestructorDeletesAllSingletonsAndTransients) {
   EXPECT_GT(DummySingleton::destructed, initialSingleton);
   EXPECT_GT(DummyTransient::destructed, initialTransient);
 }
+
+template <int N>
+struct IndexedService {
+  int x;
+  IndexedService() : x(N) {}
+};
+
+TEST(ContainerTest, ResolveUsesPerTypeSlots) {
+  Knot::Container container;
+  ASSERT_TRUE(container.registerService<IndexedService<1> >(SINGLETON));
+  ASSERT_TRUE(container.registerService<IndexedService<2> >(TRANSIENT));
+  ASSERT_TRUE(container.registerService<IndexedService<3> >(SINGLETON));
+  EXPECT_FALSE(container.registerService<IndexedService<2> >(SINGLETON));
+
+  EXPECT_EQ(container.resolve<IndexedService<1> >()->x, 1);
+  EXPECT_EQ(container.resolve<IndexedService<2> >()->x, 2);
+  EXPECT_EQ(container.resolve<IndexedService<3> >()->x, 3);
+  EXPECT_EQ(container.resolve<IndexedService<4> >(), nullptr);
+
+  Knot::Container other;
+  EXPECT_EQ(other.resolve<IndexedService<1> >(), nullptr);
+}
+
+TEST(ContainerTest, TransientHandleDestroy) {
+  DummyTransient::destructed = 0;
+  Knot::Container container;
+  container.registerService<DummyTransient>(TRANSIENT);
+
+  Knot::TransientHandle h1, h2;
+  DummyTransient* t1 = container.resolve<DummyTransient>(h1);
+  DummyTransient* t2 = container.resolve<DummyTransient>(h2);
+  ASSERT_NE(t1, nullptr);
+  ASSERT_NE(t2, nullptr);
+  EXPECT_TRUE(container.isAlive(h1));
+  EXPECT_EQ(container.getTransient<DummyTransient>(h2), t2);
+
+  EXPECT_TRUE(container.destroyTransient(h1));
+  EXPECT_EQ(DummyTransient::destructed, 1);
+  EXPECT_FALSE(container.isAlive(h1));
+  EXPECT_FALSE(container.destroyTransient(h1));
+  EXPECT_EQ(DummyTransient::destructed, 1);
+  EXPECT_TRUE(container.isAlive(h2));
+}
+
+TEST(ContainerTest, TransientHandleStaleAfterSlotReuse) {
+  Knot::Container container;
+  container.registerService<DummyTransient>(TRANSIENT);
+
+  Knot::TransientHandle old_handle, new_handle;
+  container.resolve<DummyTransient>(old_handle);
+  container.destroyTransient(old_handle);
+  container.resolve<DummyTransient>(new_handle);
+
+  EXPECT_EQ(old_handle.index, new_handle.index);
+  EXPECT_FALSE(container.isAlive(old_handle));
+  EXPECT_EQ(container.getTransient<DummyTransient>(old_handle), nullptr);
+  EXPECT_TRUE(container.isAlive(new_handle));
+
+  container.destroyAllTransients();
+  EXPECT_FALSE(container.isAlive(new_handle));
+}
+
+TEST(ContainerTest, TransientHandleForNonTransientIsInvalid) {
+  Knot::Container container;
+  container.registerService<DummySingleton>(SINGLETON);
+  Knot::TransientHandle handle;
+  DummySingleton* s = container.resolve<DummySingleton>(handle);
+  ASSERT_NE(s, nullptr);
+  EXPECT_EQ(s, container.resolve<DummySingleton>());
+  EXPECT_FALSE(container.isAlive(handle));
+  EXPECT_FALSE(container.destroyTransient(handle));
+}
+
+namespace {
+struct LazyDep {
+  static int constructed;
+  LazyDep() { ++constructed; }
+};
+int LazyDep::constructed = 0;
+
+struct UnusedDep {
+  static int constructed;
+  UnusedDep() { ++constructed; }
+};
+int UnusedDep::constructed = 0;
+
+struct LazyUser {
+  LazyDep* dep;
+  explicit LazyUser(LazyDep* d) : dep(d) {}
+};
+
+struct UnusedUser {
+  UnusedDep* dep;
+  explicit UnusedUser(UnusedDep* d) : dep(d) {}
+};
+
+struct LoopB;
+struct LoopA {
+  LoopB* b;
+  explicit LoopA(LoopB* b_) : b(b_) {}
+};
+struct LoopB {
+  LoopA* a;
+  explicit LoopB(LoopA* a_) : a(a_) {}
+};
+
+int loop_alive = 0;
+
+struct CountedLoopB;
+struct CountedLoopA {
+  explicit CountedLoopA(CountedLoopB*) { ++loop_alive; }
+  ~CountedLoopA() { --loop_alive; }
+};
+struct CountedLoopB {
+  explicit CountedLoopB(CountedLoopA*) { ++loop_alive; }
+  ~CountedLoopB() { --loop_alive; }
+};
+}  // namespace
+
+TEST(ContainerTest, InjectResolvesDependenciesLazily) {
+  LazyDep::constructed = 0;
+  UnusedDep::constructed = 0;
+  Knot::Container container;
+  container.registerService<LazyDep>(SINGLETON);
+  container.registerService<UnusedDep>(SINGLETON);
+  container.registerService<LazyUser>(TRANSIENT, container.inject<LazyDep>());
+  container.registerService<UnusedUser>(SINGLETON,
+                                        container.inject<UnusedDep>());
+  EXPECT_EQ(LazyDep::constructed, 0);
+
+  LazyUser* u1 = container.resolve<LazyUser>();
+  LazyUser* u2 = container.resolve<LazyUser>();
+  ASSERT_NE(u1, nullptr);
+  ASSERT_NE(u2, nullptr);
+  EXPECT_NE(u1, u2);
+  EXPECT_EQ(u1->dep, container.resolve<LazyDep>());
+  EXPECT_EQ(u1->dep, u2->dep);
+  EXPECT_EQ(LazyDep::constructed, 1);
+  EXPECT_EQ(UnusedDep::constructed, 0);
+}
+
+struct LazyUserOfDep {
+  Knot::Lazy<LazyDep> dep;
+  explicit LazyUserOfDep(Knot::Lazy<LazyDep> d) : dep(d) {}
+};
+
+TEST(ContainerTest, LazyDefersConstructionToFirstAccess) {
+  LazyDep::constructed = 0;
+  Knot::Container container;
+  container.registerService<LazyUserOfDep>(SINGLETON,
+                                           container.lazy<LazyDep>());
+  container.registerService<LazyDep>(SINGLETON);
+
+  LazyUserOfDep* user = container.resolve<LazyUserOfDep>();
+  ASSERT_NE(user, nullptr);
+  EXPECT_FALSE(user->dep.resolved());
+  EXPECT_EQ(LazyDep::constructed, 0);
+
+  LazyDep* dep = user->dep.get();
+  ASSERT_NE(dep, nullptr);
+  EXPECT_TRUE(user->dep.resolved());
+  EXPECT_EQ(LazyDep::constructed, 1);
+  EXPECT_EQ(&*user->dep, dep);
+  EXPECT_EQ(user->dep.operator->(), container.resolve<LazyDep>());
+  EXPECT_EQ(LazyDep::constructed, 1);
+}
+
+TEST(ContainerTest, LazyRetriesUntilResolved) {
+  Knot::Container container;
+  Knot::Lazy<LazyDep> dep = container.lazy<LazyDep>();
+  EXPECT_EQ(dep.get(), nullptr);
+  EXPECT_FALSE(dep.resolved());
+  container.registerService<LazyDep>(TRANSIENT);
+  LazyDep* first = dep.get();
+  ASSERT_NE(first, nullptr);
+  EXPECT_EQ(dep.get(), first);
+  EXPECT_EQ(Knot::Lazy<LazyDep>().get(), nullptr);
+}
+
+TEST(ContainerTest, InjectCycleResolvesToNull) {
+  Knot::Container container;
+  container.registerService<LoopA>(TRANSIENT, container.inject<LoopB>());
+  container.registerService<LoopB>(TRANSIENT, container.inject<LoopA>());
+
+  EXPECT_EQ(container.resolve<LoopA>(), nullptr);
+  EXPECT_EQ(container.resolve<LoopB>(), nullptr);
+}
+
+TEST(ContainerTest, InjectCycleTearsDownPartialChain) {
+  loop_alive = 0;
+  Knot::Container container;
+  container.registerService<CountedLoopA>(SINGLETON,
+                                          container.inject<CountedLoopB>());
+  container.registerService<CountedLoopB>(TRANSIENT,
+                                          container.inject<CountedLoopA>());
+
+  EXPECT_EQ(container.resolve<CountedLoopA>(), nullptr);
+  EXPECT_EQ(container.resolve<CountedLoopB>(), nullptr);
+  EXPECT_EQ(loop_alive, 0);
+}
+
+namespace {
+int warm_sequence = 0;
+
+template <int N>
+struct WarmLeaf {
+  int order;
+  WarmLeaf() : order(++warm_sequence) {}
+};
+
+struct WarmRoot {
+  WarmLeaf<1>* a;
+  WarmLeaf<2>* b;
+  int order;
+  WarmRoot(WarmLeaf<1>* a_, WarmLeaf<2>* b_)
+      : a(a_), b(b_), order(++warm_sequence) {}
+};
+}  // namespace
+
+TEST(ContainerTest, WarmUpBuildsSingletonsByDependencyLevel) {
+  warm_sequence = 0;
+  Knot::Container container;
+  container.registerService<WarmRoot>(SINGLETON,
+                                      container.inject<WarmLeaf<1> >(),
+                                      container.inject<WarmLeaf<2> >());
+  container.registerService<WarmLeaf<1> >(SINGLETON);
+  container.registerService<WarmLeaf<2> >(SINGLETON);
+  container.registerService<WarmLeaf<3> >(TRANSIENT);
+
+  EXPECT_EQ(container.warmUp(), 3u);
+  EXPECT_EQ(warm_sequence, 3);
+
+  WarmRoot* root = container.resolve<WarmRoot>();
+  ASSERT_NE(root, nullptr);
+  EXPECT_EQ(root->order, 3);
+  EXPECT_EQ(root->a, container.resolve<WarmLeaf<1> >());
+  EXPECT_EQ(root->b, container.resolve<WarmLeaf<2> >());
+  EXPECT_EQ(warm_sequence, 3);
+  EXPECT_EQ(container.warmUp(), 0u);
+}
+
+namespace {
+struct CountedArg {
+  static int alive;
+  int value;
+  explicit CountedArg(int v) : value(v) { ++alive; }
+  CountedArg(const CountedArg& other) : value(other.value) { ++alive; }
+  ~CountedArg() { --alive; }
+};
+int CountedArg::alive = 0;
+
+struct ArgUser {
+  int value;
+  explicit ArgUser(CountedArg arg) : value(arg.value) {}
+};
+}  // namespace
+
+TEST(ContainerTest, InlineFactoryArgumentsAreReleased) {
+  CountedArg::alive = 0;
+  {
+    Knot::Container container;
+    container.registerService<ArgUser>(TRANSIENT, CountedArg(5));
+    EXPECT_EQ(CountedArg::alive, 1);
+    ArgUser* user = container.resolve<ArgUser>();
+    ASSERT_NE(user, nullptr);
+    EXPECT_EQ(user->value, 5);
+    EXPECT_EQ(CountedArg::alive, 1);
+  }
+  EXPECT_EQ(CountedArg::alive, 0);
+}
+
+TEST(ContainerTest, ResolveManyBuildsContiguousBatch) {
+  DummyTransient::destructed = 0;
+  Knot::Container container(1 << 12);
+  container.registerService<DummyTransient>(TRANSIENT);
+
+  DummyTransient* items[8];
+  Knot::TransientHandle handle;
+  ASSERT_TRUE(container.resolveMany<DummyTransient>(8, items, handle));
+  for (int i = 0; i < 8; ++i) EXPECT_EQ(items[i], items[0] + i);
+  EXPECT_TRUE(container.isAlive(handle));
+  EXPECT_EQ(container.getTransient<DummyTransient>(handle), items[0]);
+
+  EXPECT_TRUE(container.destroyTransient(handle));
+  EXPECT_EQ(DummyTransient::destructed, 8);
+
+  ASSERT_TRUE(container.resolveMany<DummyTransient>(4, items));
+  container.destroyTransient(items[0]);
+  EXPECT_EQ(DummyTransient::destructed, 12);
+
+  ASSERT_TRUE(container.resolveMany<DummyTransient>(3, items));
+  container.destroyAllTransients();
+  EXPECT_EQ(DummyTransient::destructed, 15);
+}
+
+TEST(ContainerTest, ResolveManyRejectsNonTransient) {
+  Knot::Container container;
+  container.registerService<DummySingleton>(SINGLETON);
+  DummySingleton* items[2] = {nullptr, nullptr};
+  EXPECT_FALSE(container.resolveMany<DummySingleton>(2, items));
+  EXPECT_EQ(items[0], nullptr);
+}
+
+struct BatchItem {
+  int values[4];
+};
+
+TEST(ContainerTest, ResolveManyRejectsOverflowingCount) {
+  Knot::Container container(1 << 16);
+  container.registerService<BatchItem>(TRANSIENT);
+  BatchItem* items[1] = {nullptr};
+  // sizeof(BatchItem) * count переполняет size_t и дает 16 байт.
+  size_t count = static_cast<size_t>(-1) / sizeof(BatchItem) + 2;
+  Knot::TransientHandle handle;
+  EXPECT_FALSE(container.resolveMany<BatchItem>(count, items, handle));
+  EXPECT_FALSE(container.destroyTransient(handle));
+  EXPECT_EQ(items[0], nullptr);
+}
+
+TEST(ContainerTest, TransientMemoryIsRecycledPerType) {
+  Knot::Container container;
+  container.registerService<DummyTransient>(TRANSIENT);
+
+  DummyTransient* first = container.resolve<DummyTransient>();
+  container.destroyTransient(first);
+  Knot::RecycleStats stats = container.recycleStats<DummyTransient>();
+  EXPECT_EQ(stats.misses, 1u);
+  EXPECT_EQ(stats.hits, 0u);
+  EXPECT_EQ(stats.cached, 1u);
+
+  DummyTransient* second = container.resolve<DummyTransient>();
+  EXPECT_EQ(second, first);
+  stats = container.recycleStats<DummyTransient>();
+  EXPECT_EQ(stats.hits, 1u);
+  EXPECT_EQ(stats.cached, 0u);
+
+  container.destroyAllTransients();
+  EXPECT_EQ(container.recycleStats<DummyTransient>().cached, 1u);
+}
+
+TEST(ContainerTest, TransientRecycleLimitIsHonoured) {
+  Knot::Container container;
+  container.registerService<DummyTransient>(TRANSIENT);
+  container.registerService<DummySingleton>(SINGLETON);
+  EXPECT_FALSE(container.setRecycleLimit<DummySingleton>(4));
+  ASSERT_TRUE(container.setRecycleLimit<DummyTransient>(1));
+
+  container.resolve<DummyTransient>();
+  container.resolve<DummyTransient>();
+  container.destroyAllTransients();
+  Knot::RecycleStats stats = container.recycleStats<DummyTransient>();
+  EXPECT_EQ(stats.cached, 1u);
+  EXPECT_EQ(stats.limit, 1u);
+
+  ASSERT_TRUE(container.setRecycleLimit<DummyTransient>(0));
+  EXPECT_EQ(container.recycleStats<DummyTransient>().cached, 0u);
+  container.destroyTransient(container.resolve<DummyTransient>());
+  EXPECT_EQ(container.recycleStats<DummyTransient>().cached, 0u);
+}
+
+struct ShardPool {
+  int shard;
+  explicit ShardPool(int s) : shard(s) {}
+};
+
+TEST(ContainerTest, KeyedRegistrationsAreIndependent) {
+  Knot::Container container;
+  ASSERT_TRUE(container.registerService<ShardPool>(SINGLETON, 0));
+  ASSERT_TRUE(container.registerService<ShardPool>(1, SINGLETON, 10));
+  ASSERT_TRUE(container.registerService<ShardPool>(2, SINGLETON, 20));
+  ASSERT_TRUE(container.registerService<ShardPool>("replica", TRANSIENT, 30));
+  EXPECT_FALSE(container.registerService<ShardPool>(1, SINGLETON, 11));
+  EXPECT_FALSE(container.registerService<ShardPool>(SINGLETON, 1));
+
+  EXPECT_EQ(container.resolve<ShardPool>()->shard, 0);
+  EXPECT_EQ(container.resolve<ShardPool>(1)->shard, 10);
+  EXPECT_EQ(container.resolve<ShardPool>(2)->shard, 20);
+  EXPECT_EQ(container.resolve<ShardPool>(1), container.resolve<ShardPool>(1));
+  EXPECT_NE(container.resolve<ShardPool>(1), container.resolve<ShardPool>());
+
+  Knot::ServiceKey replica("replica");
+  ShardPool* r = container.resolve<ShardPool>(replica);
+  ASSERT_NE(r, nullptr);
+  EXPECT_EQ(r->shard, 30);
+  EXPECT_NE(container.resolve<ShardPool>("replica"), r);
+
+  EXPECT_EQ(container.resolve<ShardPool>(3), nullptr);
+  EXPECT_EQ(container.resolve<ShardPool>("primary"), nullptr);
+  EXPECT_EQ(container.resolve<DummySingleton>(1), nullptr);
+}
+
+TEST(ContainerTest, StringKeysDoNotAliasByHash) {
+  Knot::Container container;
+  size_t hash = Knot::ServiceKey::HashName("replica");
+  ASSERT_TRUE(container.registerService<ShardPool>("replica", SINGLETON, 1));
+  ASSERT_TRUE(container.registerService<ShardPool>(hash, SINGLETON, 2));
+  EXPECT_EQ(container.resolve<ShardPool>("replica")->shard, 1);
+  EXPECT_EQ(container.resolve<ShardPool>(hash)->shard, 2);
+
+  char name[] = "replica";
+  ShardPool* copied = container.resolve<ShardPool>(name);
+  name[0] = 'R';
+  EXPECT_EQ(container.resolve<ShardPool>("replica"), copied);
+
+  Knot::ServiceKey forged("primary");
+  forged.value = hash;
+  EXPECT_EQ(container.resolve<ShardPool>(forged), nullptr);
+  EXPECT_FALSE(container.registerService<ShardPool>(forged, SINGLETON, 3));
+  EXPECT_EQ(container.resolve<ShardPool>("replica")->shard, 1);
+}
+
+TEST(ContainerTest, KeyedInstancesAndHandles) {
+  Knot::Container container;
+  ShardPool external(7);
+  ASSERT_TRUE(container.registerInstance<ShardPool>(7, &external));
+  EXPECT_FALSE(container.registerInstance<ShardPool>(7, &external));
+  ASSERT_TRUE(container.registerService<ShardPool>(8, SINGLETON, 8));
+
+  Knot::ServiceHandle<ShardPool> h7 = container.handle<ShardPool>(7);
+  Knot::ServiceHandle<ShardPool> h8 = container.handle<ShardPool>(8);
+  Knot::ServiceHandle<ShardPool> missing = container.handle<ShardPool>(9);
+  ASSERT_TRUE(h7.valid());
+  ASSERT_TRUE(h8.valid());
+  EXPECT_FALSE(missing.valid());
+
+  EXPECT_EQ(container.resolve(h7), &external);
+  EXPECT_EQ(container.resolve(h8), container.resolve<ShardPool>(8));
+  EXPECT_EQ(container.resolve(missing), nullptr);
+  EXPECT_FALSE(container.handle<ShardPool>().valid());
+}
+
+namespace {
+struct IReader {
+  virtual int read() const = 0;
+};
+
+struct IWriter {
+  virtual int write() const = 0;
+};
+
+// Интерфейсы без виртуальных деструкторов: уничтожение через указатель на
+// IWriter было бы неопределенным поведением.
+struct FileChannel : IReader, IWriter {
+  static int destructed;
+  int fd;
+  explicit FileChannel(int f) : fd(f) {}
+  ~FileChannel() { ++destructed; }
+  int read() const { return fd; }
+  int write() const { return fd * 10; }
+};
+int FileChannel::destructed = 0;
+}  // namespace
+
+TEST(ContainerTest, BoundSingletonResolvesByInterface) {
+  Knot::Container container;
+  ASSERT_TRUE((container.registerService<IWriter, FileChannel>(SINGLETON, 3)));
+  EXPECT_FALSE((container.registerService<IWriter, FileChannel>(SINGLETON, 4)));
+
+  IWriter* writer = container.resolve<IWriter>();
+  ASSERT_NE(writer, nullptr);
+  EXPECT_EQ(writer, container.resolve<IWriter>());
+  EXPECT_EQ(writer->write(), 30);
+  EXPECT_EQ(static_cast<FileChannel*>(writer)->fd, 3);
+  EXPECT_NE(static_cast<void*>(writer),
+            static_cast<void*>(static_cast<FileChannel*>(writer)));
+  EXPECT_EQ(container.resolve<FileChannel>(), nullptr);
+  EXPECT_EQ(container.resolve<IReader>(), nullptr);
+
+  FileChannel::destructed = 0;
+  container.destroyAllSingletons();
+  EXPECT_EQ(FileChannel::destructed, 1);
+}
+
+TEST(ContainerTest, BoundTransientsAreDestroyedAsImplementation) {
+  Knot::Container container;
+  ASSERT_TRUE((container.registerService<IWriter, FileChannel>(TRANSIENT, 5)));
+  FileChannel::destructed = 0;
+
+  IWriter* first = container.resolve<IWriter>();
+  ASSERT_NE(first, nullptr);
+  EXPECT_EQ(first->write(), 50);
+  container.destroyTransient(first);
+  EXPECT_EQ(FileChannel::destructed, 1);
+
+  Knot::TransientHandle handle;
+  IWriter* second = container.resolve<IWriter>(handle);
+  ASSERT_NE(second, nullptr);
+  EXPECT_EQ(second, first);
+  EXPECT_EQ(container.getTransient<IWriter>(handle), second);
+  EXPECT_TRUE(container.destroyTransient(handle));
+  EXPECT_EQ(FileChannel::destructed, 2);
+
+  IWriter* batch[2];
+  EXPECT_FALSE(container.resolveMany<IWriter>(2, batch));
+}
+
+TEST(ContainerTest, SealRejectsFurtherRegistration) {
+  Knot::Container container;
+  ASSERT_TRUE(container.registerService<DummySingleton>(SINGLETON));
+  ASSERT_TRUE(container.registerService<ShardPool>(1, SINGLETON, 10));
+  EXPECT_FALSE(container.isSealed());
+  ASSERT_TRUE(container.seal());
+  EXPECT_TRUE(container.isSealed());
+  EXPECT_TRUE(container.seal());
+
+  ShardPool external(5);
+  EXPECT_FALSE(container.registerService<DummyTransient>(TRANSIENT));
+  EXPECT_FALSE(container.registerService<ShardPool>(2, SINGLETON, 20));
+  EXPECT_FALSE(container.registerInstance<ShardPool>(&external));
+  EXPECT_FALSE((container.registerService<IReader, FileChannel>(SINGLETON, 3)));
+  EXPECT_EQ(container.resolve<DummyTransient>(), nullptr);
+  EXPECT_EQ(container.resolve<ShardPool>(2), nullptr);
+}
+
+TEST(ContainerTest, SealedRegistryResolvesEveryRegistration) {
+  Knot::Container container;
+  ASSERT_TRUE(container.registerService<DummySingleton>(SINGLETON));
+  ASSERT_TRUE(container.registerService<DummyTransient>(TRANSIENT));
+  for (int shard = 0; shard < 8; ++shard)
+    ASSERT_TRUE(container.registerService<ShardPool>(shard, SINGLETON, shard));
+  ASSERT_TRUE(container.registerService<ShardPool>("replica", TRANSIENT, 30));
+  Knot::ServiceHandle<ShardPool> before = container.handle<ShardPool>(3);
+  ASSERT_TRUE(container.seal());
+
+  DummySingleton* s = container.resolve<DummySingleton>();
+  ASSERT_NE(s, nullptr);
+  EXPECT_EQ(container.resolve<DummySingleton>(), s);
+  EXPECT_NE(container.resolve<DummyTransient>(), nullptr);
+  for (int shard = 0; shard < 8; ++shard) {
+    ShardPool* pool = container.resolve<ShardPool>(shard);
+    ASSERT_NE(pool, nullptr);
+    EXPECT_EQ(pool->shard, shard);
+  }
+  EXPECT_EQ(container.resolve<ShardPool>("replica")->shard, 30);
+  EXPECT_EQ(container.resolve(before), container.resolve<ShardPool>(3));
+  EXPECT_EQ(container.resolve<ShardPool>(8), nullptr);
+  EXPECT_EQ(container.resolve<ShardPool>("primary"), nullptr);
+  EXPECT_EQ(container.resolve<ShardPool>(), nullptr);
+}
+
+TEST(ContainerTest, SealEmptyContainer) {
+  Knot::Container container;
+  ASSERT_TRUE(container.seal());
+  EXPECT_EQ(container.resolve<DummySingleton>(), nullptr);
+  EXPECT_EQ(container.resolve<ShardPool>(1), nullptr);
+  EXPECT_FALSE(container.registerService<DummySingleton>(SINGLETON));
+}
+
+TEST(ContainerTest, ServiceRefResolvesThroughCapturedEntry) {
+  Knot::Container container;
+  ASSERT_TRUE(container.registerService<DummySingleton>(SINGLETON));
+  ASSERT_TRUE(container.registerService<ShardPool>(TRANSIENT, 7));
+  ASSERT_TRUE(container.registerService<ShardPool>("replica", SINGLETON, 30));
+
+  Knot::ServiceRef<DummySingleton> singleton = container.ref<DummySingleton>();
+  ASSERT_TRUE(singleton.valid());
+  DummySingleton* s = singleton.get();
+  ASSERT_NE(s, nullptr);
+  EXPECT_EQ(singleton.get(), s);
+  EXPECT_EQ(container.resolve<DummySingleton>(), s);
+
+  Knot::ServiceRef<ShardPool> transient = container.ref<ShardPool>();
+  ShardPool* first = transient.get();
+  ShardPool* second = transient.get();
+  ASSERT_NE(first, nullptr);
+  ASSERT_NE(second, nullptr);
+  EXPECT_NE(first, second);
+  EXPECT_EQ(transient->shard, 7);
+
+  EXPECT_EQ(container.ref<ShardPool>("replica")->shard, 30);
+  EXPECT_FALSE(container.ref<ShardPool>(1).valid());
+  EXPECT_EQ(container.ref<ShardPool>(1).get(), nullptr);
+  EXPECT_EQ(container.ref<DummyTransient>().get(), nullptr);
+  EXPECT_EQ(Knot::ServiceRef<DummySingleton>().get(), nullptr);
+
+  container.destroyAllSingletons();
+  EXPECT_NE(singleton.get(), nullptr);
+}
+
+namespace {
+int request_order[8];
+int request_order_count = 0;
+
+template <int N>
+struct RequestObject {
+  int id;
+  RequestObject() : id(N) {}
+  ~RequestObject() {
+    if (request_order_count < 8) request_order[request_order_count++] = N;
+  }
+};
+}  // namespace
+
+TEST(ContainerTest, EndRequestDestroysRequestInstancesInReverse) {
+  request_order_count = 0;
+  Knot::Container container(1 << 16);
+  ASSERT_TRUE(container.registerService<RequestObject<1> >(TRANSIENT));
+  ASSERT_TRUE(container.registerService<RequestObject<2> >(TRANSIENT));
+  ASSERT_TRUE(container.registerService<RequestObject<3> >(SINGLETON));
+  RequestObject<1>* outside = container.resolve<RequestObject<1> >();
+  ASSERT_NE(outside, nullptr);
+
+  ASSERT_TRUE(container.beginRequest());
+  EXPECT_TRUE(container.inRequest());
+  EXPECT_FALSE(container.beginRequest());
+  Knot::TransientHandle first;
+  ASSERT_NE(container.resolve<RequestObject<1> >(first), nullptr);
+  RequestObject<2>* second = container.resolve<RequestObject<2> >();
+  ASSERT_NE(second, nullptr);
+  RequestObject<3>* singleton = container.resolve<RequestObject<3> >();
+  ASSERT_NE(singleton, nullptr);
+  container.endRequest();
+
+  EXPECT_FALSE(container.inRequest());
+  ASSERT_EQ(request_order_count, 2);
+  EXPECT_EQ(request_order[0], 2);
+  EXPECT_EQ(request_order[1], 1);
+  EXPECT_FALSE(container.isAlive(first));
+  EXPECT_EQ(container.resolve<RequestObject<3> >(), singleton);
+  EXPECT_EQ(outside->id, 1);
+}
+
+TEST(ContainerTest, RequestArenaIsRewoundBetweenRequests) {
+  Knot::Container container(1 << 16);
+  ASSERT_TRUE(container.registerService<RequestObject<4> >(TRANSIENT));
+  ASSERT_TRUE(container.beginRequest(256));
+  RequestObject<4>* first = container.resolve<RequestObject<4> >();
+  ASSERT_NE(first, nullptr);
+  container.destroyTransient(first);
+  container.endRequest();
+
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_TRUE(container.beginRequest(256));
+    EXPECT_EQ(container.resolve<RequestObject<4> >(), first);
+    container.endRequest();
+  }
+
+  ASSERT_TRUE(container.beginRequest(256));
+  int resolved = 0;
+  while (container.resolve<RequestObject<4> >()) ++resolved;
+  EXPECT_GT(resolved, 0);
+  EXPECT_LT(resolved, 256);
+  container.endRequest();
+}
+
+namespace {
+int teardown_order[8];
+int teardown_order_count = 0;
+
+template <int N>
+struct TeardownNode {
+  const void* dep;
+  explicit TeardownNode(const void* d = NULL) : dep(d) {}
+  ~TeardownNode() {
+    if (teardown_order_count < 8) teardown_order[teardown_order_count++] = N;
+  }
+};
+}  // namespace
+
+TEST(ContainerTest, TeardownFollowsReverseCreationOrder) {
+  teardown_order_count = 0;
+  {
+    Knot::Container container;
+    // Регистрации идут в обратном порядке зависимостей.
+    ASSERT_TRUE(container.registerService<TeardownNode<3> >(
+        TRANSIENT, container.inject<TeardownNode<2> >()));
+    ASSERT_TRUE(container.registerService<TeardownNode<2> >(
+        SINGLETON, container.inject<TeardownNode<1> >()));
+    ASSERT_TRUE(container.registerService<TeardownNode<1> >(SINGLETON));
+    ASSERT_TRUE(container.registerService<TeardownNode<4> >(SINGLETON));
+    TeardownNode<3>* handler = container.resolve<TeardownNode<3> >();
+    ASSERT_NE(handler, nullptr);
+    EXPECT_EQ(handler->dep, container.resolve<TeardownNode<2> >());
+  }
+  ASSERT_EQ(teardown_order_count, 3);
+  EXPECT_EQ(teardown_order[0], 3);
+  EXPECT_EQ(teardown_order[1], 2);
+  EXPECT_EQ(teardown_order[2], 1);
+}
+
+TEST(ContainerTest, DestroyAllSingletonsKeepsTransientsInLog) {
+  teardown_order_count = 0;
+  Knot::Container container;
+  ASSERT_TRUE(container.registerService<TeardownNode<2> >(
+      SINGLETON, container.inject<TeardownNode<1> >()));
+  ASSERT_TRUE(container.registerService<TeardownNode<1> >(SINGLETON));
+  ASSERT_TRUE(container.registerService<TeardownNode<3> >(TRANSIENT));
+  Knot::TransientHandle handle;
+  ASSERT_NE(container.resolve<TeardownNode<3> >(handle), nullptr);
+  ASSERT_NE(container.resolve<TeardownNode<2> >(), nullptr);
+
+  container.destroyAllSingletons();
+  ASSERT_EQ(teardown_order_count, 2);
+  EXPECT_EQ(teardown_order[0], 2);
+  EXPECT_EQ(teardown_order[1], 1);
+  EXPECT_TRUE(container.isAlive(handle));
+
+  container.destroyAllSingletons();
+  EXPECT_EQ(teardown_order_count, 2);
+  container.destroyAllTransients();
+  ASSERT_EQ(teardown_order_count, 3);
+  EXPECT_EQ(teardown_order[2], 3);
+  EXPECT_NE(container.resolve<TeardownNode<2> >(), nullptr);
+}
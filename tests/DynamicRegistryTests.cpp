@@ -0,0 +1,192 @@
+#include <gtest/gtest.h>
+
+#include "../include/knot-di/Container.hpp"
+#include "../include/knot-di/Scope.hpp"
+
+namespace {
+template <int N>
+struct Numbered {
+  static int destructed;
+  int x;
+  Numbered() : x(N) {}
+  ~Numbered() { ++destructed; }
+};
+template <int N>
+int Numbered<N>::destructed = 0;
+
+// Регистрирует Numbered<1>..Numbered<N> с заданной стратегией.
+template <int N>
+struct RegisterNumbered {
+  static int run(Knot::Container& c, Strategy strategy) {
+    int registered = RegisterNumbered<N - 1>::run(c, strategy);
+    return registered + (c.registerService<Numbered<N> >(strategy) ? 1 : 0);
+  }
+};
+
+template <>
+struct RegisterNumbered<0> {
+  static int run(Knot::Container&, Strategy) { return 0; }
+};
+
+struct Leaf {
+  int x;
+  Leaf() : x(7) {}
+};
+
+struct Root {
+  Leaf* leaf;
+  explicit Root(Leaf* l) : leaf(l) {}
+};
+}  // namespace
+
+TEST(DynamicRegistryTest, RegistryGrowsPastInitialCapacity) {
+  Knot::Container container(1 << 20);
+  ASSERT_EQ(RegisterNumbered<40>::run(container, SINGLETON), 40);
+  EXPECT_FALSE(container.registerService<Numbered<17> >(SINGLETON));
+
+  EXPECT_EQ(container.resolve<Numbered<1> >()->x, 1);
+  EXPECT_EQ(container.resolve<Numbered<23> >()->x, 23);
+  EXPECT_EQ(container.resolve<Numbered<40> >()->x, 40);
+  EXPECT_EQ(container.resolve<Numbered<23> >(),
+            container.resolve<Numbered<23> >());
+  EXPECT_EQ(container.resolve<Numbered<41> >(), nullptr);
+}
+
+TEST(DynamicRegistryTest, TransientHandlesSurviveTableGrowth) {
+  Knot::Container container(1 << 20);
+  ASSERT_TRUE(container.registerService<Leaf>(TRANSIENT));
+
+  Knot::TransientHandle handles[50];
+  Leaf* leaves[50];
+  for (int i = 0; i < 50; ++i) {
+    leaves[i] = container.resolve<Leaf>(handles[i]);
+    ASSERT_NE(leaves[i], nullptr);
+  }
+  for (int i = 0; i < 50; ++i) {
+    EXPECT_TRUE(container.isAlive(handles[i]));
+    EXPECT_EQ(container.getTransient<Leaf>(handles[i]), leaves[i]);
+  }
+  EXPECT_TRUE(container.destroyTransient(handles[0]));
+  EXPECT_FALSE(container.isAlive(handles[0]));
+  EXPECT_TRUE(container.isAlive(handles[49]));
+}
+
+TEST(DynamicRegistryTest, ScopeServesEntriesPastInitialCapacity) {
+  Knot::Container container(1 << 20);
+  ASSERT_EQ(RegisterNumbered<12>::run(container, SCOPED), 12);
+  Knot::Scope scope(container);
+  Numbered<12>* last = scope.resolve<Numbered<12> >();
+  ASSERT_NE(last, nullptr);
+  EXPECT_EQ(last->x, 12);
+  EXPECT_EQ(scope.resolve<Numbered<12> >(), last);
+  ASSERT_NE(scope.resolve<Numbered<1> >(), nullptr);
+
+  Numbered<12>::destructed = 0;
+  scope.end();
+  EXPECT_EQ(Numbered<12>::destructed, 1);
+}
+
+TEST(DynamicRegistryTest, WarmUpCoversGrownRegistry) {
+  Knot::Container container(1 << 20);
+  ASSERT_EQ(RegisterNumbered<10>::run(container, SINGLETON), 10);
+  container.registerService<Root>(SINGLETON, container.inject<Leaf>());
+  container.registerService<Leaf>(SINGLETON);
+
+  EXPECT_EQ(container.warmUp(), 12u);
+  EXPECT_EQ(container.resolve<Root>()->leaf, container.resolve<Leaf>());
+}
+
+TEST(DynamicRegistryTest, RegistrationFailsWhenPoolIsExhausted) {
+  Knot::Container container(2048);
+  int registered = RegisterNumbered<40>::run(container, TRANSIENT);
+  EXPECT_GT(registered, 0);
+  EXPECT_LT(registered, 40);
+  EXPECT_FALSE(container.registerService<Numbered<1> >(TRANSIENT));
+}
+
+TEST(DynamicRegistryTest, KeyedRegistrationsShareGrowingTable) {
+  Knot::Container container(1 << 20);
+  ASSERT_TRUE(container.registerService<Leaf>(TRANSIENT));
+  for (int shard = 0; shard < 100; ++shard)
+    ASSERT_TRUE(container.registerService<Numbered<1> >(shard, SINGLETON));
+  EXPECT_FALSE(container.registerService<Numbered<1> >(42, SINGLETON));
+
+  Numbered<1>* first = container.resolve<Numbered<1> >(0);
+  Numbered<1>* last = container.resolve<Numbered<1> >(99);
+  ASSERT_NE(first, nullptr);
+  ASSERT_NE(last, nullptr);
+  EXPECT_NE(first, last);
+  EXPECT_EQ(container.resolve(container.handle<Numbered<1> >(99)), last);
+  EXPECT_EQ(container.resolve<Numbered<1> >(100), nullptr);
+  EXPECT_EQ(container.resolve<Numbered<1> >(), nullptr);
+}
+
+TEST(DynamicRegistryTest, SealedTableFindsGrownRegistry) {
+  Knot::Container container(1 << 20);
+  ASSERT_EQ(RegisterNumbered<40>::run(container, SINGLETON), 40);
+  ASSERT_TRUE(container.registerService<Leaf>(TRANSIENT));
+  for (int shard = 0; shard < 300; ++shard)
+    ASSERT_TRUE(container.registerService<Numbered<1> >(shard, SINGLETON));
+  Numbered<1>* first = container.resolve<Numbered<1> >(0);
+  ASSERT_TRUE(container.seal());
+
+  EXPECT_FALSE(
+      container.registerService<Root>(SINGLETON, container.inject<Leaf>()));
+  EXPECT_EQ(container.resolve<Numbered<1> >(0), first);
+  for (int shard = 0; shard < 300; ++shard)
+    ASSERT_NE(container.resolve<Numbered<1> >(shard), nullptr) << shard;
+  EXPECT_EQ(container.resolve<Numbered<1> >(300), nullptr);
+  EXPECT_EQ(container.resolve<Numbered<1> >()->x, 1);
+  EXPECT_EQ(container.resolve<Numbered<40> >()->x, 40);
+  EXPECT_NE(container.resolve<Leaf>(), nullptr);
+  EXPECT_EQ(container.resolve<Root>(), nullptr);
+  EXPECT_EQ(container.resolve<Numbered<41> >(), nullptr);
+}
+
+TEST(DynamicRegistryTest, ChildContainerExtendsGrownRegistry) {
+  Knot::Container parent(1 << 20);
+  ASSERT_EQ(RegisterNumbered<8>::run(parent, SCOPED), 8);
+  parent.registerService<Leaf>(SINGLETON);
+  Knot::Container child(Knot::CHILD_OF, parent, 1 << 16);
+  ASSERT_TRUE(child.registerService<Root>(SINGLETON, child.inject<Leaf>()));
+  EXPECT_EQ(child.warmUp(), 1u);
+  EXPECT_EQ(child.resolve<Root>()->leaf, parent.resolve<Leaf>());
+
+  Knot::Scope scope(child);
+  ASSERT_NE(scope.resolve<Numbered<8> >(), nullptr);
+  EXPECT_EQ(scope.resolve<Numbered<8> >()->x, 8);
+  EXPECT_EQ(scope.resolve<Root>(), child.resolve<Root>());
+}
+
+TEST(DynamicRegistryTest, CreationLogCompactsUnderTransientChurn) {
+  Numbered<2>::destructed = 0;
+  Knot::Container container(1 << 20);
+  ASSERT_TRUE(container.registerService<Numbered<2> >(TRANSIENT));
+  Knot::TransientHandle kept[20];
+  for (int i = 0; i < 20; ++i)
+    ASSERT_NE(container.resolve<Numbered<2> >(kept[i]), nullptr);
+  for (int i = 0; i < 1000; ++i) {
+    Knot::TransientHandle handle;
+    ASSERT_NE(container.resolve<Numbered<2> >(handle), nullptr);
+    ASSERT_TRUE(container.destroyTransient(handle));
+  }
+  EXPECT_EQ(Numbered<2>::destructed, 1000);
+  for (int i = 0; i < 20; ++i) EXPECT_TRUE(container.isAlive(kept[i]));
+  container.destroyAllTransients();
+  EXPECT_EQ(Numbered<2>::destructed, 1020);
+  EXPECT_FALSE(container.isAlive(kept[0]));
+}
+
+TEST(DynamicRegistryTest, DefaultPoolResolvesInjectedTransients) {
+  Knot::Container container;
+  ASSERT_TRUE(container.registerService<Leaf>(SINGLETON));
+  ASSERT_TRUE(
+      container.registerService<Root>(TRANSIENT, container.inject<Leaf>()));
+  for (int i = 0; i < 8; ++i) {
+    Root* root = container.resolve<Root>();
+    ASSERT_NE(root, nullptr);
+    EXPECT_EQ(root->leaf->x, 7);
+  }
+  container.destroyAllTransients();
+  EXPECT_NE(container.resolve<Root>(), nullptr);
+}
@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+
+#include "../include/knot-di/Container.hpp"
+#include "../include/knot-di/Scope.hpp"
+
+namespace {
+struct Config {
+  int x;
+  Config() : x(1) {}
+};
+
+struct Request {
+  Config* config;
+  explicit Request(Config* c) : config(c) {}
+};
+
+struct Session {
+  int id;
+  Session() : id(2) {}
+};
+
+struct CycleB;
+struct CycleA {
+  CycleB* b;
+  explicit CycleA(CycleB* b_) : b(b_) {}
+};
+struct CycleB {
+  CycleA* a;
+  explicit CycleB(CycleA* a_) : a(a_) {}
+};
+
+// Суммирует разрешения всех записей реестра.
+struct ResolveTotal {
+  size_t resolves;
+  size_t entries;
+  ResolveTotal() : resolves(0), entries(0) {}
+  void operator()(const Knot::ServiceStats& stats) {
+    resolves += stats.counters.resolves;
+    ++entries;
+  }
+};
+}  // namespace
+
+TEST(InstrumentationTest, CountsResolvesAndConstructions) {
+  Knot::Container container;
+  container.registerService<Config>(SINGLETON);
+  container.registerService<Request>(TRANSIENT, container.inject<Config>());
+
+  for (int i = 0; i < 3; ++i) ASSERT_NE(container.resolve<Request>(), nullptr);
+
+  Knot::ServiceStats config = container.serviceStats<Config>();
+  EXPECT_EQ(config.type, Knot::TypeId<Config>());
+  EXPECT_EQ(config.strategy, SINGLETON);
+  EXPECT_EQ(config.counters.resolves, 3u);
+  EXPECT_EQ(config.counters.constructs, 1u);
+  EXPECT_EQ(config.counters.bytes, sizeof(Config));
+  EXPECT_EQ(config.counters.failures, 0u);
+
+  Knot::ServiceStats request = container.serviceStats<Request>();
+  EXPECT_EQ(request.counters.resolves, 3u);
+  EXPECT_EQ(request.counters.constructs, 3u);
+  EXPECT_GE(request.counters.bytes, sizeof(Request));
+  EXPECT_GE(request.counters.construct_ns, request.counters.max_construct_ns);
+
+  EXPECT_EQ(container.serviceStats<Session>().counters.resolves, 0u);
+}
+
+TEST(InstrumentationTest, CountsFailedResolves) {
+  Knot::Container container;
+  container.registerService<CycleA>(TRANSIENT, container.inject<CycleB>());
+  container.registerService<CycleB>(TRANSIENT, container.inject<CycleA>());
+
+  EXPECT_EQ(container.resolve<CycleA>(), nullptr);
+
+  Knot::ServiceStats stats = container.serviceStats<CycleA>();
+  EXPECT_EQ(stats.counters.resolves, 2u);
+  EXPECT_EQ(stats.counters.constructs, 1u);
+  // Отказывают и вложенное разрешение в цикле, и внешнее.
+  EXPECT_EQ(stats.counters.failures, 2u);
+}
+
+TEST(InstrumentationTest, SnapshotVisitAndReset) {
+  Knot::Container container;
+  container.registerService<Config>(SINGLETON);
+  container.registerService<Session>(7, SINGLETON);
+  container.resolve<Config>();
+  container.resolve<Session>(7);
+  container.resolve<Session>(7);
+
+  Knot::ServiceStats one[1];
+  EXPECT_EQ(container.snapshotStats(one, 1), 2u);
+  EXPECT_EQ(one[0].type, Knot::TypeId<Config>());
+
+  Knot::ServiceStats all[2];
+  ASSERT_EQ(container.snapshotStats(all, 2), 2u);
+  EXPECT_EQ(all[1].type, Knot::TypeId<Knot::Keyed<Session> >());
+  EXPECT_EQ(all[1].key, 7u);
+  EXPECT_EQ(all[1].index, 1u);
+  EXPECT_EQ(all[1].counters.resolves, 2u);
+  EXPECT_EQ(container.serviceStats<Session>(7).counters.constructs, 1u);
+
+  ResolveTotal total = container.visitStats(ResolveTotal());
+  EXPECT_EQ(total.entries, 2u);
+  EXPECT_EQ(total.resolves, 3u);
+
+  container.resetStats();
+  EXPECT_EQ(container.visitStats(ResolveTotal()).resolves, 0u);
+  EXPECT_EQ(container.serviceStats<Config>().counters.bytes, 0u);
+}
+
+TEST(InstrumentationTest, ScopedResolvesAreCounted) {
+  Knot::Container container;
+  container.registerService<Session>(SCOPED);
+  Knot::Scope scope(container);
+  scope.resolve<Session>();
+  scope.resolve<Session>();
+
+  Knot::ServiceStats stats = container.serviceStats<Session>();
+  EXPECT_EQ(stats.counters.resolves, 2u);
+  EXPECT_EQ(stats.counters.constructs, 1u);
+  EXPECT_EQ(stats.counters.bytes, sizeof(Session) < sizeof(void*)
+                                      ? sizeof(void*)
+                                      : sizeof(Session));
+}
@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 
 #include <cassert>
+#include <cstring>
 
 #include "../include/knot-di/MemoryPool.hpp"
 
@@ -159,3 +160,215 @@ TEST(MemoryPoolTest, DestructorFreesHeapMemory) {
   ASSERT_NE(ptr, nullptr);
   delete pool;  // Should free all memory without leaks or crashes
 }
+
+TEST(MemoryPoolTest, BufferDeallocateReusesBlock) {
+  alignas(16) char buffer[128];
+  Knot::MemoryPool pool(buffer);
+  void* ptr1 = pool.allocateRaw(32, alignof(int));
+  ASSERT_NE(ptr1, nullptr);
+  pool.deallocate(ptr1, 32);
+  EXPECT_EQ(pool.getUsedBytes(), 0);
+  EXPECT_EQ(pool.getBufferOffset(), 0);
+
+  void* keep = pool.allocateRaw(16, alignof(int));
+  void* ptr2 = pool.allocateRaw(32, alignof(int));
+  void* guard = pool.allocateRaw(16, alignof(int));
+  ASSERT_NE(ptr2, nullptr);
+  ASSERT_NE(guard, nullptr);
+  pool.deallocate(ptr2, 32);
+  void* ptr3 = pool.allocateRaw(32, alignof(int));
+  EXPECT_EQ(ptr2, ptr3);
+  (void)keep;
+}
+
+TEST(MemoryPoolTest, BufferCoalescesAdjacentBlocks) {
+  alignas(16) char buffer[256];
+  Knot::MemoryPool pool(buffer);
+  void* a = pool.allocateRaw(64, alignof(int));
+  void* b = pool.allocateRaw(64, alignof(int));
+  void* c = pool.allocateRaw(64, alignof(int));
+  ASSERT_NE(c, nullptr);
+  pool.deallocate(a, 64);
+  pool.deallocate(b, 64);
+
+  void* big = pool.allocateRaw(128, alignof(int));
+  EXPECT_EQ(big, a);
+}
+
+TEST(MemoryPoolTest, BufferReuseHonoursAlignment) {
+  alignas(16) char buffer[256];
+  Knot::MemoryPool pool(buffer);
+  void* small = pool.allocateRaw(16, alignof(int));
+  void* guard = pool.allocateRaw(16, alignof(int));
+  ASSERT_NE(guard, nullptr);
+  pool.deallocate(small, 16);
+
+  void* aligned = pool.allocateRaw(32, 64);
+  ASSERT_NE(aligned, nullptr);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(aligned) % 64, 0);
+}
+
+TEST(MemoryPoolTest, BufferChurnDoesNotExhaustPool) {
+  alignas(16) char buffer[1024];
+  Knot::MemoryPool pool(buffer);
+  const size_t kLive = 8;
+  unsigned char* ptrs[kLive] = {};
+  size_t sizes[kLive] = {};
+  unsigned seed = 12345;
+
+  for (int i = 0; i < 100000; ++i) {
+    size_t slot = i % kLive;
+    if (ptrs[slot]) {
+      for (size_t j = 0; j < sizes[slot]; ++j)
+        ASSERT_EQ(ptrs[slot][j], static_cast<unsigned char>(slot));
+      pool.deallocate(ptrs[slot], sizes[slot]);
+    }
+    seed = seed * 1103515245u + 12345u;
+    sizes[slot] = 1 + (seed >> 16) % 96;
+    ptrs[slot] = static_cast<unsigned char*>(
+        pool.allocateRaw(sizes[slot], slot % 2 ? 8 : 32));
+    ASSERT_NE(ptrs[slot], nullptr) << "iteration " << i;
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(ptrs[slot]) % (slot % 2 ? 8 : 32),
+              0);
+    std::memset(ptrs[slot], static_cast<int>(slot), sizes[slot]);
+  }
+
+  for (size_t slot = 0; slot < kLive; ++slot)
+    pool.deallocate(ptrs[slot], sizes[slot]);
+  EXPECT_EQ(pool.getUsedBytes(), 0);
+  void* whole = pool.allocateRaw(1024, 16);
+  EXPECT_NE(whole, nullptr);
+}
+
+TEST(MemoryPoolTest, MisalignedBufferChurnBalancesUsedBytes) {
+  alignas(16) unsigned char raw[1024 + 8];
+  Knot::MemoryPool pool(raw + 8, 1024);
+  const size_t kLive = 8;
+  unsigned char* ptrs[kLive] = {};
+  size_t sizes[kLive] = {};
+  unsigned seed = 777;
+
+  for (int i = 0; i < 20000; ++i) {
+    size_t slot = i % kLive;
+    if (ptrs[slot]) pool.deallocate(ptrs[slot], sizes[slot]);
+    seed = seed * 1103515245u + 12345u;
+    sizes[slot] = 1 + (seed >> 16) % 64;
+    size_t align = size_t(8) << (seed >> 8) % 3;
+    ptrs[slot] =
+        static_cast<unsigned char*>(pool.allocateRaw(sizes[slot], align));
+    ASSERT_NE(ptrs[slot], nullptr) << "iteration " << i;
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(ptrs[slot]) % align, 0);
+  }
+
+  for (size_t slot = 0; slot < kLive; ++slot)
+    pool.deallocate(ptrs[slot], sizes[slot]);
+  EXPECT_EQ(pool.getUsedBytes(), 0);
+  // Буфер начинается с границы гранулы, и все 1016 байт снова одним блоком
+  EXPECT_NE(pool.allocateRaw(1024 - 8, 16), nullptr);
+}
+
+TEST(MemoryPoolTest, HeapChunksHonourAlignment) {
+  Knot::MemoryPool pool(1 << 16);
+  void* small = pool.allocateRaw(8, alignof(int));
+  void* aligned = pool.allocateRaw(32, 64);
+  void* page = pool.allocateRaw(128, 4096);
+  ASSERT_NE(small, nullptr);
+  ASSERT_NE(aligned, nullptr);
+  ASSERT_NE(page, nullptr);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(aligned) % 64, 0);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(page) % 4096, 0);
+}
+
+TEST(MemoryPoolTest, HeapChunksGrowAndReuseBlocks) {
+  Knot::MemoryPool pool(1 << 16, 256);
+  unsigned char* blocks[32];
+  for (int i = 0; i < 32; ++i) {
+    blocks[i] = static_cast<unsigned char*>(pool.allocateRaw(64, 16));
+    ASSERT_NE(blocks[i], nullptr);
+    std::memset(blocks[i], i, 64);
+  }
+  for (int i = 0; i < 32; ++i)
+    EXPECT_EQ(blocks[i][63], static_cast<unsigned char>(i));
+  EXPECT_EQ(pool.getUsedBytes(), 32u * 64);
+
+  pool.deallocate(blocks[3], 64);
+  EXPECT_EQ(pool.allocateRaw(64, 16), blocks[3]);
+
+  pool.reset();
+  EXPECT_EQ(pool.getUsedBytes(), 0);
+  EXPECT_EQ(pool.getBuffer(), nullptr);
+  EXPECT_NE(pool.allocateRaw(64, 16), nullptr);
+}
+
+TEST(MemoryPoolTest, HeapChunksKeepBudget) {
+  Knot::MemoryPool pool(256, 64);
+  void* a = pool.allocateRaw(128, alignof(int));
+  void* b = pool.allocateRaw(128, alignof(int));
+  ASSERT_NE(a, nullptr);
+  ASSERT_NE(b, nullptr);
+  EXPECT_EQ(pool.allocateRaw(16, alignof(int)), nullptr);
+  pool.deallocate(a, 128);
+  EXPECT_NE(pool.allocateRaw(128, alignof(int)), nullptr);
+}
+
+TEST(MemoryPoolTest, HeapChunkSizeIsRoundedToGranule) {
+  Knot::MemoryPool pool(100000, 100);
+  void* a = pool.allocateRaw(48, alignof(int));
+  void* b = pool.allocateRaw(48, alignof(int));
+  void* c = pool.allocateRaw(4, alignof(int));
+  ASSERT_NE(a, nullptr);
+  ASSERT_NE(b, nullptr);
+  ASSERT_NE(c, nullptr);
+  void* d = pool.allocateRaw(64, alignof(int));  // Открывает новый блок кучи
+  ASSERT_NE(d, nullptr);
+  std::memset(d, 0x5A, 64);
+  pool.deallocate(c, 4);
+  pool.deallocate(a, 48);
+  pool.deallocate(b, 48);
+  pool.deallocate(d, 64);
+  EXPECT_EQ(pool.getUsedBytes(), 0);
+}
+
+TEST(MemoryPoolTest, HeapWithoutChunksUsesOperatorNew) {
+  Knot::MemoryPool pool(128, 0);
+  void* ptr = pool.allocateRaw(32, alignof(int));
+  ASSERT_NE(ptr, nullptr);
+  EXPECT_EQ(pool.getBuffer(), nullptr);
+  pool.deallocate(ptr, 32);
+  EXPECT_EQ(pool.getUsedBytes(), 0);
+}
+
+#if KNOT_POOL_MMAP
+TEST(MemoryPoolTest, MappedPoolReservesBudgetLazily) {
+  const size_t budget = 3 << 20;
+  Knot::MemoryPool pool(budget, Knot::MemoryPool::RESERVE);
+  EXPECT_EQ(pool.getBuffer(), nullptr);
+  unsigned char* table =
+      static_cast<unsigned char*>(pool.allocateRaw(2 << 20, 64));
+  ASSERT_NE(table, nullptr);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(pool.getBuffer()) %
+                KNOT_POOL_HUGE_PAGE_BYTES,
+            0);
+  std::memset(table, 0x5A, 2 << 20);
+  void* page = pool.allocateRaw(4096, 4096);
+  ASSERT_NE(page, nullptr);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(page) % 4096, 0);
+  EXPECT_EQ(pool.allocateRaw(1 << 20, 16), nullptr);
+
+  void* buffer = pool.getBuffer();
+  pool.reset();
+  EXPECT_EQ(pool.getUsedBytes(), 0);
+  EXPECT_EQ(pool.getBuffer(), buffer);
+  EXPECT_NE(pool.allocateRaw(budget, 16), nullptr);
+}
+
+TEST(MemoryPoolTest, LargeDefaultPoolIsMapped) {
+  Knot::MemoryPool pool(KNOT_POOL_MMAP_BYTES);
+  EXPECT_EQ(Knot::MemoryPool::defaultChunkBytes(KNOT_POOL_MMAP_BYTES),
+            static_cast<size_t>(Knot::MemoryPool::RESERVE));
+  ASSERT_NE(pool.allocateRaw(64, 16), nullptr);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(pool.getBuffer()) %
+                KNOT_POOL_HUGE_PAGE_BYTES,
+            0);
+}
+#endif
@@ -0,0 +1,150 @@
+#include <gtest/gtest.h>
+
+#include "../include/knot-di/Container.hpp"
+#include "../include/knot-di/MemoryPool.hpp"
+
+namespace {
+struct Settings {
+  int x;
+  Settings() : x(1) {}
+};
+
+struct Message {
+  int id;
+  Message() : id(2) {}
+};
+
+struct LookupTable {
+  uint32_t cells[1 << 18];
+  LookupTable() {
+    for (size_t i = 0; i < sizeof(cells) / sizeof(cells[0]); ++i)
+      cells[i] = static_cast<uint32_t>(i);
+  }
+};
+}  // namespace
+
+TEST(PoolStatsTest, TrackHighWaterAndLiveBlocks) {
+  alignas(16) char buffer[256];
+  Knot::MemoryPool pool(buffer);
+  void* a = pool.allocateRaw(64, alignof(int));
+  void* b = pool.allocateRaw(32, alignof(int));
+  ASSERT_NE(b, nullptr);
+  pool.deallocate(a, 64);
+
+  Knot::PoolStats stats = pool.getStats();
+  EXPECT_EQ(stats.used_bytes, 32u);
+  EXPECT_EQ(stats.high_water, 96u);
+  EXPECT_EQ(stats.peak_offset, 96u);
+  EXPECT_EQ(stats.max_bytes, 256u);
+  EXPECT_EQ(stats.live_blocks, 1u);
+  EXPECT_EQ(stats.allocations, 2u);
+  EXPECT_EQ(stats.allocation_histogram[Knot::MemoryPool::sizeBucket(64)], 1u);
+  EXPECT_EQ(stats.allocation_histogram[Knot::MemoryPool::sizeBucket(32)], 1u);
+
+  pool.reset();
+  stats = pool.getStats();
+  EXPECT_EQ(stats.live_blocks, 0u);
+  EXPECT_EQ(stats.high_water, 96u);
+
+  pool.resetStats();
+  stats = pool.getStats();
+  EXPECT_EQ(stats.high_water, 0u);
+  EXPECT_EQ(stats.allocations, 0u);
+}
+
+TEST(PoolStatsTest, RecordAlignmentPaddingAndFailures) {
+  alignas(16) char raw[129];
+  Knot::MemoryPool pool(raw + 1, 128);
+  // Начало буфера сдвигается до границы гранулы, пропущенные байты - отступ
+  size_t granule = Knot::MemoryPool::bucketLimit(0);
+  EXPECT_EQ(pool.getStats().padding_bytes, granule - 1);
+  ASSERT_NE(pool.allocateRaw(8, 8), nullptr);
+  EXPECT_EQ(pool.getStats().padding_bytes, granule - 1);
+
+  EXPECT_EQ(pool.allocateRaw(200, 8), nullptr);
+  EXPECT_EQ(pool.allocateRaw(150, 8), nullptr);
+  Knot::PoolStats stats = pool.getStats();
+  EXPECT_EQ(stats.failures, 2u);
+  EXPECT_EQ(stats.largest_failure, 200u);
+  EXPECT_EQ(stats.last_failure, 150u);
+  EXPECT_EQ(stats.failure_histogram[Knot::MemoryPool::sizeBucket(200)], 2u);
+  EXPECT_EQ(stats.allocations, 1u);
+}
+
+TEST(PoolStatsTest, BucketsDoubleFromGranule) {
+  size_t granule = Knot::MemoryPool::bucketLimit(0);
+  EXPECT_EQ(Knot::MemoryPool::sizeBucket(1), 0u);
+  EXPECT_EQ(Knot::MemoryPool::sizeBucket(granule), 0u);
+  EXPECT_EQ(Knot::MemoryPool::sizeBucket(granule + 1), 1u);
+  EXPECT_EQ(Knot::MemoryPool::bucketLimit(3), granule * 8);
+  EXPECT_EQ(Knot::MemoryPool::sizeBucket(static_cast<size_t>(-1)),
+            static_cast<size_t>(KNOT_POOL_STAT_BUCKETS - 1));
+}
+
+TEST(PoolStatsTest, HeapModeCountsLiveBlocks) {
+  Knot::MemoryPool pool(128);
+  void* a = pool.allocateRaw(48, alignof(int));
+  void* b = pool.allocateRaw(48, alignof(int));
+  EXPECT_EQ(pool.allocateRaw(48, alignof(int)), nullptr);
+  pool.deallocate(a, 48);
+
+  Knot::PoolStats stats = pool.getStats();
+  EXPECT_EQ(stats.live_blocks, 1u);
+  EXPECT_EQ(stats.high_water, 96u);
+  EXPECT_EQ(stats.failures, 1u);
+  EXPECT_EQ(stats.last_failure, 48u);
+  pool.deallocate(b, 48);
+}
+
+TEST(PoolStatsTest, ContainerPoolStatsSizeTheBuffer) {
+  alignas(16) static uint8_t buffer[1024];
+  Knot::Container container(buffer);
+  ASSERT_TRUE(container.registerService<Settings>(SINGLETON));
+  ASSERT_TRUE(container.registerService<Message>(TRANSIENT));
+  Message* m = container.resolve<Message>();
+  ASSERT_NE(m, nullptr);
+  container.destroyTransient(m);
+
+  Knot::PoolStats stats = container.poolStats();
+  EXPECT_EQ(stats.max_bytes, sizeof(buffer));
+  EXPECT_EQ(stats.allocations, 2u);
+  EXPECT_EQ(stats.failures, 0u);
+  EXPECT_GE(stats.peak_offset, stats.high_water);
+  EXPECT_LE(stats.peak_offset, sizeof(buffer));
+}
+
+TEST(PoolStatsTest, ChildPoolIsEmptyUntilFirstUse) {
+  Knot::Container parent;
+  ASSERT_TRUE(parent.registerService<Settings>(SINGLETON));
+  ASSERT_TRUE(parent.registerService<Message>(TRANSIENT));
+  {
+    Knot::Container child(Knot::CHILD_OF, parent);
+    ASSERT_NE(child.resolve<Settings>(), nullptr);
+    Knot::PoolStats stats = child.poolStats();
+    EXPECT_EQ(stats.allocations, 0u);
+    EXPECT_EQ(stats.used_bytes, 0u);
+
+    Message* m = child.resolve<Message>();
+    ASSERT_NE(m, nullptr);
+    stats = child.poolStats();
+    EXPECT_EQ(stats.allocations, 1u);
+    EXPECT_LE(stats.peak_offset, size_t(KNOT_CHILD_POOL_CHUNK_BYTES));
+    child.destroyTransient(m);
+  }
+}
+
+TEST(PoolStatsTest, LargeContainerPoolIsMapped) {
+  Knot::Container container(4 << 20);
+  ASSERT_TRUE(container.registerService<Settings>(SINGLETON));
+  ASSERT_TRUE(container.registerService<LookupTable>(SINGLETON));
+  LookupTable* table = container.resolve<LookupTable>();
+  ASSERT_NE(table, nullptr);
+  EXPECT_EQ(table->cells[12345], 12345u);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(table) % alignof(LookupTable), 0u);
+
+  Knot::PoolStats stats = container.poolStats();
+  EXPECT_EQ(stats.max_bytes, static_cast<size_t>(4 << 20));
+  EXPECT_GE(stats.used_bytes, sizeof(LookupTable) + sizeof(Settings));
+  // Весь бюджет - одна область, поэтому оба синглтона лежат в ней подряд.
+  EXPECT_GE(stats.buffer_offset, sizeof(LookupTable) + sizeof(Settings));
+}
@@ -0,0 +1,208 @@
+#include <gtest/gtest.h>
+
+#include "../include/knot-di/Scope.hpp"
+
+namespace {
+int g_order[4];
+int g_order_count = 0;
+
+struct Session {
+  int id;
+  Session() : id(5) {}
+  ~Session() { g_order[g_order_count++] = 1; }
+};
+
+struct Handler {
+  int id;
+  Handler() : id(6) {}
+  ~Handler() { g_order[g_order_count++] = 2; }
+};
+
+struct Shared {
+  int x;
+  Shared() : x(1) {}
+};
+}  // namespace
+
+TEST(ScopeTest, ContainerDoesNotResolveScopedDirectly) {
+  Knot::Container container;
+  ASSERT_TRUE(container.registerService<Session>(SCOPED));
+  EXPECT_EQ(container.resolve<Session>(), nullptr);
+}
+
+TEST(ScopeTest, ScopedInstanceIsCachedPerScope) {
+  Knot::Container container;
+  container.registerService<Session>(SCOPED);
+
+  Knot::Scope scope1(container);
+  Knot::Scope scope2(container);
+  Session* a1 = scope1.resolve<Session>();
+  Session* a2 = scope1.resolve<Session>();
+  Session* b = scope2.resolve<Session>();
+  ASSERT_NE(a1, nullptr);
+  ASSERT_NE(b, nullptr);
+  EXPECT_EQ(a1, a2);
+  EXPECT_NE(a1, b);
+  EXPECT_EQ(a1->id, 5);
+}
+
+TEST(ScopeTest, NonScopedServicesFallBackToContainer) {
+  Knot::Container container;
+  container.registerService<Shared>(SINGLETON);
+  Knot::Scope scope(container);
+  EXPECT_EQ(scope.resolve<Shared>(), container.resolve<Shared>());
+  EXPECT_EQ(scope.resolve<Session>(), nullptr);
+}
+
+TEST(ScopeTest, EndDestroysInReverseOrderAndRewindsArena) {
+  Knot::Container container;
+  container.registerService<Session>(SCOPED);
+  container.registerService<Handler>(SCOPED);
+
+  Knot::Scope scope(container);
+  g_order_count = 0;
+  ASSERT_NE(scope.resolve<Session>(), nullptr);
+  ASSERT_NE(scope.resolve<Handler>(), nullptr);
+  EXPECT_GT(scope.getArena().getUsedBytes(), 0u);
+
+  scope.end();
+  ASSERT_EQ(g_order_count, 2);
+  EXPECT_EQ(g_order[0], 2);
+  EXPECT_EQ(g_order[1], 1);
+  EXPECT_EQ(scope.getArena().getUsedBytes(), 0u);
+
+  Session* again = scope.resolve<Session>();
+  ASSERT_NE(again, nullptr);
+  EXPECT_EQ(again->id, 5);
+}
+
+TEST(ScopeTest, ArenaExhaustionReturnsNull) {
+  Knot::Container container;
+  container.registerService<Session>(SCOPED);
+  Knot::Scope scope(container, 1);
+  EXPECT_EQ(scope.resolve<Session>(), nullptr);
+}
+
+TEST(ScopeTest, KeyedScopedInstancesAreCachedPerKey) {
+  g_order_count = 0;
+  Knot::Container container;
+  container.registerService<Session>("left", SCOPED);
+  container.registerService<Session>("right", SCOPED);
+
+  Knot::Scope scope(container);
+  Session* left = scope.resolve<Session>("left");
+  Session* right = scope.resolve<Session>("right");
+  ASSERT_NE(left, nullptr);
+  ASSERT_NE(right, nullptr);
+  EXPECT_NE(left, right);
+  EXPECT_EQ(scope.resolve<Session>("left"), left);
+  EXPECT_EQ(scope.resolve<Session>(), nullptr);
+}
+
+namespace {
+struct IAudit {
+  virtual int level() const = 0;
+};
+
+struct Tagged {
+  int tag;
+  Tagged() : tag(9) {}
+};
+
+struct AuditLog : Tagged, IAudit {
+  static int destructed;
+  ~AuditLog() { ++destructed; }
+  int level() const { return 2; }
+};
+int AuditLog::destructed = 0;
+}  // namespace
+
+TEST(ScopeTest, BoundScopedServiceResolvesByInterface) {
+  Knot::Container container;
+  ASSERT_TRUE((container.registerService<IAudit, AuditLog>(SCOPED)));
+  Knot::Scope scope(container);
+  IAudit* audit = scope.resolve<IAudit>();
+  ASSERT_NE(audit, nullptr);
+  EXPECT_EQ(scope.resolve<IAudit>(), audit);
+  EXPECT_EQ(audit->level(), 2);
+  EXPECT_EQ(static_cast<AuditLog*>(audit)->tag, 9);
+
+  AuditLog::destructed = 0;
+  scope.end();
+  EXPECT_EQ(AuditLog::destructed, 1);
+}
+
+namespace {
+struct Unit {
+  Session* session;
+  explicit Unit(Session* s) : session(s) {}
+};
+
+struct Request {
+  Unit* unit;
+  explicit Request(Unit* u) : unit(u) {}
+};
+
+struct RequestJob {
+  Request* request;
+  explicit RequestJob(Request* r) : request(r) {}
+};
+
+struct Registry {
+  Session* session;
+  explicit Registry(Session* s) : session(s) {}
+};
+}  // namespace
+
+TEST(ScopeTest, ScopedDependenciesComeFromTheSameScope) {
+  Knot::Container container;
+  ASSERT_TRUE(container.registerService<Session>(SCOPED));
+  ASSERT_TRUE(
+      container.registerService<Unit>(SCOPED, container.inject<Session>()));
+  ASSERT_TRUE(
+      container.registerService<Request>(SCOPED, container.inject<Unit>()));
+
+  Knot::Scope scope1(container);
+  Knot::Scope scope2(container);
+  Request* r1 = scope1.resolve<Request>();
+  Request* r2 = scope2.resolve<Request>();
+  ASSERT_NE(r1, nullptr);
+  ASSERT_NE(r2, nullptr);
+  ASSERT_NE(r1->unit, nullptr);
+  ASSERT_NE(r1->unit->session, nullptr);
+  EXPECT_EQ(r1->unit, scope1.resolve<Unit>());
+  EXPECT_EQ(r1->unit->session, scope1.resolve<Session>());
+  EXPECT_NE(r1->unit, r2->unit);
+  EXPECT_NE(r1->unit->session, r2->unit->session);
+
+  // Вне области видимости SCOPED зависимость по-прежнему не разрешается
+  EXPECT_EQ(container.resolve<Request>(), nullptr);
+
+  g_order_count = 0;
+  scope1.end();
+  EXPECT_EQ(g_order_count, 1);
+}
+
+TEST(ScopeTest, ScopedDependencyOfTransientAndSingleton) {
+  Knot::Container container;
+  ASSERT_TRUE(container.registerService<Session>(SCOPED));
+  ASSERT_TRUE(
+      container.registerService<Unit>(SCOPED, container.inject<Session>()));
+  ASSERT_TRUE(
+      container.registerService<Request>(SCOPED, container.inject<Unit>()));
+  ASSERT_TRUE(container.registerService<RequestJob>(
+      TRANSIENT, container.inject<Request>()));
+  ASSERT_TRUE(container.registerService<Registry>(
+      SINGLETON, container.inject<Session>()));
+
+  Knot::Scope scope(container);
+  RequestJob* job = scope.resolve<RequestJob>();
+  ASSERT_NE(job, nullptr);
+  EXPECT_EQ(job->request, scope.resolve<Request>());
+
+  // Синглтон переживает область видимости и SCOPED зависимость не получает
+  Registry* registry = scope.resolve<Registry>();
+  ASSERT_NE(registry, nullptr);
+  EXPECT_EQ(registry->session, nullptr);
+  container.destroyTransient(job);
+}
@@ -0,0 +1,154 @@
+#include <gtest/gtest.h>
+
+#include "../include/knot-di/StaticContainer.hpp"
+
+namespace {
+struct Config {
+  int value;
+  Config() : value(7) {}
+};
+
+struct Logger {
+  int level;
+  Logger(int l) : level(l) {}
+};
+
+struct Request {
+  static int destructed;
+  int id;
+  Request() : id(1) {}
+  ~Request() { ++destructed; }
+};
+int Request::destructed = 0;
+
+struct Clock {
+  long now;
+};
+
+struct alignas(32) Wide {
+  char data[32];
+};
+
+typedef Knot::StaticContainer<Knot::TypeList<
+    Knot::Service<Config>,
+    Knot::Service<Logger, SINGLETON, Knot::Factory1<Logger, int> >,
+    Knot::Service<Request, TRANSIENT>, Knot::Service<Clock, EXTERNAL>,
+    Knot::Service<Wide> > >
+    AppContainer;
+
+struct alignas(64) WideRequest {
+  static int destructed;
+  char data[64];
+  ~WideRequest() { ++destructed; }
+};
+int WideRequest::destructed = 0;
+
+typedef Knot::StaticContainer<
+    Knot::TypeList<Knot::Service<WideRequest, TRANSIENT> > >
+    WideContainer;
+}  // namespace
+
+TEST(StaticContainerTest, ResolveSingletonReturnsSameInstance) {
+  AppContainer container;
+  Config* c1 = container.resolve<Config>();
+  Config* c2 = container.resolve<Config>();
+  ASSERT_NE(c1, nullptr);
+  EXPECT_EQ(c1, c2);
+  EXPECT_EQ(c1->value, 7);
+  EXPECT_EQ(AppContainer::size(), 5u);
+}
+
+TEST(StaticContainerTest, FactoryWithArgumentsNeedsConfigure) {
+  AppContainer container;
+  EXPECT_EQ(container.resolve<Logger>(), nullptr);
+  ASSERT_TRUE(container.configure<Logger>(3));
+  Logger* logger = container.resolve<Logger>();
+  ASSERT_NE(logger, nullptr);
+  EXPECT_EQ(logger->level, 3);
+  EXPECT_FALSE(container.configure<Logger>(4));
+}
+
+TEST(StaticContainerTest, ResolveTransientCreatesNewInstances) {
+  Request::destructed = 0;
+  AppContainer container;
+  Request* r1 = container.resolve<Request>();
+  Request* r2 = container.resolve<Request>();
+  ASSERT_NE(r1, nullptr);
+  ASSERT_NE(r2, nullptr);
+  EXPECT_NE(r1, r2);
+  container.destroyTransient(r1);
+  container.destroyTransient(r2);
+  EXPECT_EQ(Request::destructed, 2);
+}
+
+TEST(StaticContainerTest, ExternalInstance) {
+  AppContainer container;
+  Clock clock = {42};
+  EXPECT_EQ(container.resolve<Clock>(), nullptr);
+  EXPECT_TRUE(container.registerInstance<Clock>(&clock));
+  EXPECT_FALSE(container.registerInstance<Clock>(&clock));
+  EXPECT_EQ(container.resolve<Clock>(), &clock);
+}
+
+TEST(StaticContainerTest, OverAlignedSingleton) {
+  AppContainer container;
+  Wide* w = container.resolve<Wide>();
+  ASSERT_NE(w, nullptr);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(w) % alignof(Wide), 0u);
+}
+
+TEST(StaticContainerTest, OverAlignedTransient) {
+  WideRequest::destructed = 0;
+  WideContainer container;
+  WideRequest* requests[8];
+  for (int i = 0; i < 8; ++i) {
+    requests[i] = container.resolve<WideRequest>();
+    ASSERT_NE(requests[i], nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(requests[i]) % alignof(WideRequest),
+              0u);
+  }
+  for (int i = 0; i < 8; ++i) container.destroyTransient(requests[i]);
+  EXPECT_EQ(WideRequest::destructed, 8);
+}
+
+namespace {
+struct Ticket {
+  static int alive;
+  Ticket() { ++alive; }
+  ~Ticket() { --alive; }
+};
+int Ticket::alive = 0;
+
+typedef Knot::StaticContainer<Knot::TypeList<
+    Knot::Service<Ticket, TRANSIENT, Knot::Factory<Ticket>, 2> > >
+    TicketContainer;
+}  // namespace
+
+TEST(StaticContainerTest, TransientSlotsAreFixed) {
+  Ticket::alive = 0;
+  {
+    TicketContainer container;
+    Ticket* t1 = container.resolve<Ticket>();
+    Ticket* t2 = container.resolve<Ticket>();
+    ASSERT_NE(t1, nullptr);
+    ASSERT_NE(t2, nullptr);
+    EXPECT_EQ(container.resolve<Ticket>(), nullptr);
+
+    container.destroyTransient(t1);
+    container.destroyTransient(t1);
+    EXPECT_EQ(Ticket::alive, 1);
+    EXPECT_EQ(container.resolve<Ticket>(), t1);
+    EXPECT_EQ(Ticket::alive, 2);
+  }
+  EXPECT_EQ(Ticket::alive, 0);
+}
+
+TEST(StaticContainerTest, DestroyAllSingletonsRecreates) {
+  AppContainer container;
+  Config* c1 = container.resolve<Config>();
+  c1->value = 99;
+  container.destroyAllSingletons();
+  Config* c2 = container.resolve<Config>();
+  ASSERT_NE(c2, nullptr);
+  EXPECT_EQ(c2->value, 7);
+}